@@ -0,0 +1,159 @@
+// Host micro-benchmarks for the sketch hot paths, built by env:native:
+//   pio run -e native && .pio/build/native/program
+
+#include <chrono>
+#include <stdio.h>
+
+#include "draw.h"
+#include "player.h"
+
+#define BENCH_ITERATIONS 10000
+
+typedef void (*benchfn_t)(uint32_t i);
+
+volatile uint32_t benchSink; // keeps results observable so calls aren't optimized away
+
+void benchRun(const char *name, benchfn_t fn, uint32_t iterations = BENCH_ITERATIONS)
+{
+  // warm up caches and branch predictors
+  for (uint32_t i = 0; i < iterations / 10; i++)
+    fn(i);
+
+  auto start = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < iterations; i++)
+    fn(i);
+  auto end = std::chrono::steady_clock::now();
+
+  double ns = std::chrono::duration<double, std::nano>(end - start).count();
+  printf("%-24s %10u ops %12.1f ns/op\n", name, iterations, ns / iterations);
+}
+
+void benchGenerateMaze(uint32_t i)
+{
+  nativeMillis = i;
+  generateMaze();
+  benchSink = MAZE[MAZE_HEIGHT / 2];
+}
+
+void benchDrawMaze(uint32_t i)
+{
+  // sweep through every animation state the renderer can see
+  playerHeading = (Direction)(i % NUM_DIRECTIONS);
+  playerRotation = (Rotation)((int)((i >> 2) % 3) - 1);
+  zoom = playerRotation == NO_ROT ? (i >> 4) % H_INSET : 0;
+  hShift = playerRotation == NO_ROT ? 0 : (i >> 4) % CLIP_WIDTH;
+  invalidateView();
+  drawMaze();
+  benchSink = drawBuffer[NUM_ROWS / 2];
+}
+
+// repeated view, only the signature is computed
+void benchDrawMazeUnchanged(uint32_t)
+{
+  benchSink = drawMaze();
+}
+
+// straight views only, so both paths draw the same frame
+void benchRasterWalls(uint32_t i)
+{
+  playerRotation = NO_ROT;
+  zoom = (i >> 3) % H_INSET;
+  scanClear();
+  for (byte depth = 0; depth < MAX_DEPTH; depth++)
+    rasterWalls(depth, (i + depth * 37) & 0x2F); // never the exit
+  benchSink = drawBuffer[NUM_ROWS / 2];
+}
+
+void benchComposeWalls(uint32_t i)
+{
+  playerRotation = NO_ROT;
+  zoom = (i >> 3) % H_INSET;
+  scanClear();
+  for (byte depth = 0; depth < MAX_DEPTH; depth++)
+    composeWalls(depth, (i + depth * 37) & 0x2F);
+  benchSink = drawBuffer[NUM_ROWS / 2];
+}
+
+// frames inside one turn: the incoming view is already drawn, each frame draws the outgoing one
+// and composes the slide
+void benchDrawTurn(uint32_t i)
+{
+  playerHeading = (Direction)((i / CLIP_WIDTH / 2) % NUM_DIRECTIONS);
+  playerRotation = (i / CLIP_WIDTH) & 1 ? LEFT : RIGHT;
+  zoom = 0;
+  hShift = i % CLIP_WIDTH;
+  if (hShift == 0)
+    invalidateView(); // a new turn
+  drawMaze();
+  benchSink = drawBuffer[NUM_ROWS / 2];
+}
+
+// straight views like benchDrawMaze, rendered by the raycaster whichever renderer drawMaze() uses
+void benchDrawRaycast(uint32_t i)
+{
+  playerHeading = (Direction)(i % NUM_DIRECTIONS);
+  zoom = (i >> 2) % H_INSET;
+  scanClear();
+  drawRaycast();
+  benchSink = drawBuffer[NUM_ROWS / 2];
+}
+
+void benchDrawLine(uint32_t i)
+{
+  int8_t x0 = i % SCREEN_WIDTH;
+  int8_t y0 = (i >> 4) % SCREEN_HEIGHT;
+  drawLine(x0, y0, SCREEN_WIDTH - 1 - x0, SCREEN_HEIGHT - 1 - y0);
+  benchSink = drawBuffer[y0];
+}
+
+// 90 degrees with a mirror: transpose plus both flips, the most work an orientation can take
+void benchScanOrient(uint32_t i)
+{
+  drawBuffer[i % NUM_ROWS] ^= (rowdata_t)i;
+  scanOrientFrame(drawBuffer, SCAN_SWAP_XY | SCAN_FLIP_X | SCAN_FLIP_Y);
+  benchSink = drawBuffer[NUM_ROWS / 2];
+}
+
+void benchScanIsr(uint32_t i)
+{
+  if ((i % Matrix::Slots) == 0)
+    scanShow();
+  TCB0_INT_vect();
+#if defined(SCAN_SPI_ASYNC)
+  while (SPI0.INTCTRL)
+    SPI0_INT_vect();
+#endif
+  benchSink = curLine;
+}
+
+int main()
+{
+  PROFILE_INIT();
+  scanInit();
+  scanDisplay(true);
+  resetMaze();
+
+  // what the chip would see: one SPI burst per row slot, from the compile-time figures in scan.h
+  printf("matrix %dx%d (%d panel%s), %u-byte row burst, %lu us of SPI per %lu us slot, %u Hz refresh\n",
+         MATRIX_WIDTH, MATRIX_HEIGHT, MATRIX_PANELS, MATRIX_PANELS > 1 ? "s" : "", Matrix::RowBytes,
+         (unsigned long)(Matrix::BurstTicks / SCAN_TICKS_PER_US),
+         (unsigned long)((scanPeriod + 1UL) / SCAN_TICKS_PER_US), scanRefreshHz());
+  printf("%-24s %10s %17s\n", "benchmark", "iterations", "time");
+  benchRun("generateMaze", benchGenerateMaze, BENCH_ITERATIONS / 10);
+
+  resetMaze();
+  benchRun("drawMaze", benchDrawMaze);
+  benchRun("drawMaze (unchanged)", benchDrawMazeUnchanged);
+  benchRun("drawMaze (turn)", benchDrawTurn);
+  benchRun("rasterWalls", benchRasterWalls);
+  benchRun("composeWalls", benchComposeWalls);
+  benchRun("drawRaycast", benchDrawRaycast);
+  benchRun("drawLine", benchDrawLine);
+  benchRun("scanOrientFrame", benchScanOrient);
+  benchRun("TCB0_INT_vect", benchScanIsr, BENCH_ITERATIONS * 10);
+
+  // with -DPROFILE, per-region figures from the scopes inside the sketch
+  PROFILE_REPORT();
+
+  return 0;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Smallest unsigned word that holds `Bits` cells (no <type_traits> on AVR)
+template <bool Fits8, bool Fits16> struct GridWord { typedef uint32_t type; };
+template <bool Fits16> struct GridWord<true, Fits16> { typedef uint8_t type; };
+template <> struct GridWord<false, true> { typedef uint16_t type; };
+
+// W x H bit-packed grid, one word per row with column 0 in the most significant used bit.
+// Cells outside the grid read as clear, so lookups near the border need no checks by callers.
+template <uint8_t W, uint8_t H>
+struct BitGrid {
+  typedef typename GridWord<(W <= 8), (W <= 16)>::type row_t;
+
+  static_assert(W >= 3 && W <= 32, "BitGrid rows are 3 to 32 cells wide");
+
+  static constexpr uint8_t Width = W;
+  static constexpr uint8_t Height = H;
+  static constexpr row_t FULL = (row_t)(~(row_t)0 >> (sizeof(row_t) * 8 - W));
+
+  row_t rows[H];
+
+  static constexpr row_t colMask(uint8_t col) { return (row_t)1 << ((W - 1) - col); }
+
+  row_t &operator[](uint8_t row) { return rows[row]; }
+  const row_t &operator[](uint8_t row) const { return rows[row]; }
+
+  void fill() {
+    for (uint8_t i = 0; i < H; i++) rows[i] = FULL;
+  }
+
+  // unchecked cell access for loops that already stay inside the grid
+  void set(uint8_t row, uint8_t col) { rows[row] |= colMask(col); }
+  void clear(uint8_t row, uint8_t col) { rows[row] &= ~colMask(col); }
+  bool get(uint8_t row, uint8_t col) const { return rows[row] & colMask(col); }
+
+  // bounds-checked, anything outside the grid is clear
+  bool test(uint8_t row, uint8_t col) const { return row < H && col < W && get(row, col); }
+
+  // cells col - 1, col, col + 1 of a row as bits 2, 1, 0, for one shift instead of three lookups
+  uint8_t rowWindow(int8_t row, int8_t col) const {
+    if (row < 0 || row >= H || col < -1 || col > W) return 0;
+    row_t bits = rows[row];
+    int8_t shift = (W - 2) - col;
+    return (shift >= 0 ? bits >> shift : bits << -shift) & 0x07;
+  }
+
+  // 3x3 block centred on (row, col) as three rowWindow()s, top row in bits 8..6
+  uint16_t neighborhood(int8_t row, int8_t col) const {
+    return (uint16_t)rowWindow(row - 1, col) << 6 | rowWindow(row, col) << 3 | rowWindow(row + 1, col);
+  }
+};
+
+// bit of a cell in neighborhood(), dr/dc in -1..1
+#define NEIGHBOR_BIT(dr, dc) (1 << ((1 - (dr)) * 3 + (1 - (dc))))
@@ -23,53 +23,186 @@ public:
 #define Y0 SCREEN_HALF_HEIGHT
 #define MAX_DEPTH 3
 
-extern uint16_t zoom, hShift;
+extern uint8_t zoom, hShift;
 extern Rotation playerRotation;
 extern Direction playerHeading;
-extern int playerRow, playerCol;
+extern int8_t playerRow, playerCol;
 
 uint16_t shift;
 bool blocked;
 
-void drawLine(int8_t x0_param, int8_t y0_param, int8_t x1, int8_t y1)
+// drawing is clipped to whichever of the view and the matrix is smaller
+#define CLIP_WIDTH (SCREEN_WIDTH < NUM_COLS ? SCREEN_WIDTH : NUM_COLS)
+#define CLIP_HEIGHT (SCREEN_HEIGHT < NUM_ROWS ? SCREEN_HEIGHT : NUM_ROWS)
+
+// single-column masks, looked up to avoid a variable shift per pixel on AVR
+const rowdata_t pixelMasks[NUM_COLS] PROGMEM = {
+    0x0001, 0x0002, 0x0004, 0x0008, 0x0010, 0x0020, 0x0040, 0x0080,
+#if NUM_COLS > 8
+    0x0100, 0x0200, 0x0400, 0x0800, 0x1000, 0x2000, 0x4000, 0x8000,
+#endif
+};
+
+inline rowdata_t readRowData(const rowdata_t *p)
 {
-  // Simple line drawing - only basic math operations
-  int8_t dx = x1 - x0_param;
-  int8_t dy = y1 - y0_param;
-  int8_t steps = (dx < 0 ? -dx : dx);
-  if ((dy < 0 ? -dy : dy) > steps)
-    steps = (dy < 0 ? -dy : dy);
+  return sizeof(rowdata_t) == 1 ? pgm_read_byte(p) : pgm_read_word(p);
+}
+
+inline rowdata_t pixelMask(int8_t x)
+{
+  return readRowData(&pixelMasks[x]);
+}
 
-  if (steps == 0)
+// columns x0..x1 inclusive; the shift wraps to 0 at the top column, which the subtraction relies on
+inline rowdata_t spanMask(int8_t x0, int8_t x1)
+{
+  return (rowdata_t)((rowdata_t)(pixelMask(x1) << 1) - pixelMask(x0));
+}
+
+void drawHLine(int8_t x0, int8_t x1, int8_t y)
+{
+  if (y < 0 || y >= CLIP_HEIGHT)
+    return;
+  if (x0 > x1)
   {
-    if (x0_param >= 0 && x0_param < SCREEN_WIDTH && y0_param >= 0 && y0_param < SCREEN_HEIGHT)
-    {
-      scanSetPixel(x0_param, y0_param, true);
-    }
+    int8_t t = x0;
+    x0 = x1;
+    x1 = t;
+  }
+  if (x0 < 0)
+    x0 = 0;
+  if (x1 >= CLIP_WIDTH)
+    x1 = CLIP_WIDTH - 1;
+  if (x0 > x1)
+    return;
+
+  scanOrRow(y, spanMask(x0, x1));
+}
+
+void drawVLine(int8_t x, int8_t y0, int8_t y1)
+{
+  if (x < 0 || x >= CLIP_WIDTH)
     return;
+  if (y0 > y1)
+  {
+    int8_t t = y0;
+    y0 = y1;
+    y1 = t;
   }
+  if (y0 < 0)
+    y0 = 0;
+  if (y1 >= CLIP_HEIGHT)
+    y1 = CLIP_HEIGHT - 1;
+
+  rowdata_t mask = pixelMask(x);
+  for (int8_t y = y0; y <= y1; y++)
+    scanOrRow(y, mask);
+}
 
-  for (int8_t i = 0; i <= steps; i++)
+void drawLine(int8_t x0, int8_t y0, int8_t x1, int8_t y1)
+{
+  if (y0 == y1)
   {
-    int8_t x = x0_param + (dx * i) / steps;
-    int8_t y = y0_param + (dy * i) / steps;
-    if (x >= 0 && x < SCREEN_WIDTH && y >= 0 && y < SCREEN_HEIGHT)
+    drawHLine(x0, x1, y0);
+    return;
+  }
+  if (x0 == x1)
+  {
+    drawVLine(x0, y0, y1);
+    return;
+  }
+
+  // Bresenham-style stepping along the major axis; the minor axis advances when the
+  // error term overflows, which lands on the same pixels as truncating (d * i) / steps
+  int8_t dx = x1 - x0, dy = y1 - y0;
+  int8_t sx = dx < 0 ? -1 : 1, sy = dy < 0 ? -1 : 1;
+  uint8_t adx = dx < 0 ? -dx : dx, ady = dy < 0 ? -dy : dy;
+  bool xMajor = adx >= ady;
+  uint8_t steps = xMajor ? adx : ady;
+  uint8_t minor = xMajor ? ady : adx;
+  uint8_t error = 0;
+
+  int8_t x = x0, y = y0;
+  for (uint8_t i = 0; i <= steps; i++)
+  {
+    if (x >= 0 && x < CLIP_WIDTH && y >= 0 && y < CLIP_HEIGHT)
+      scanOrRow(y, pixelMask(x));
+
+    error += minor;
+    bool stepMinor = error >= steps;
+    if (stepMinor)
+      error -= steps;
+
+    if (xMajor)
     {
-      scanSetPixel(x, y, true);
+      x += sx;
+      if (stepMinor)
+        y += sy;
     }
+    else
+    {
+      y += sy;
+      if (stepMinor)
+        x += sx;
+    }
+  }
+}
+
+void drawRect(int8_t left, int8_t top, int8_t right, int8_t bottom)
+{
+  drawHLine(left, right, top);
+  drawHLine(left, right, bottom);
+  drawVLine(left, top, bottom);
+  drawVLine(right, top, bottom);
+}
+
+void fillRect(int8_t left, int8_t top, int8_t right, int8_t bottom)
+{
+  if (left > right)
+    return;
+  for (int8_t y = top; y <= bottom; y++)
+    drawHLine(left, right, y);
+}
+
+// Perspective corners for every half-width x that drawWalls() can ask for, i.e.
+// SCREEN_HALF_WIDTH - H_INSET * depth plus up to 2 * H_INSET of zoom (exit walk-out).
+// Built at compile time so drawing does a flash lookup instead of float math.
+#define CORNER_TABLE_SIZE (SCREEN_HALF_WIDTH + 2 * H_INSET + 1)
+
+static_assert(SCREEN_HALF_WIDTH - H_INSET * MAX_DEPTH >= 0, "innermost wall must have a non-negative half-width");
+
+struct CornerTable
+{
+  uint8_t corners[CORNER_TABLE_SIZE][4]; // left, top, right, bottom
+};
+
+constexpr CornerTable makeCornerTable()
+{
+  CornerTable table = {};
+  for (int x = 0; x < CORNER_TABLE_SIZE; x++)
+  {
+    int y = (int)(RATIO * x);
+    table.corners[x][0] = X0 - x < 0 ? 0 : X0 - x;
+    table.corners[x][1] = Y0 - y < 0 ? 0 : Y0 - y;
+    table.corners[x][2] = X0 + x > SCREEN_WIDTH - 1 ? SCREEN_WIDTH - 1 : X0 + x;
+    table.corners[x][3] = Y0 + y > SCREEN_HEIGHT - 1 ? SCREEN_HEIGHT - 1 : Y0 + y;
   }
+  return table;
 }
 
+const CornerTable cornerTable PROGMEM = makeCornerTable();
+
 void xToCorners(uint16_t x, Point *points)
 {
-  uint16_t y = (uint16_t)(RATIO * x);
+  if (x >= CORNER_TABLE_SIZE)
+    x = CORNER_TABLE_SIZE - 1;
+
+  const uint8_t *corner = cornerTable.corners[x];
+  uint8_t left = pgm_read_byte(corner + 0);
+  uint8_t top = pgm_read_byte(corner + 1);
+  uint8_t right = pgm_read_byte(corner + 2);
+  uint8_t bottom = pgm_read_byte(corner + 3);
 
-  // Clamp coordinates to screen bounds
-  int16_t left = max(0, (int16_t)(X0 - x));
-  int16_t right = min(SCREEN_WIDTH - 1, (int16_t)(X0 + x));
-  int16_t top = max(0, (int16_t)(Y0 - y));
-  int16_t bottom = min(SCREEN_HEIGHT - 1, (int16_t)(Y0 + y));
-  
   points[0].set(left, top);     // 0 = top left
   points[1].set(right, top);    // 1 = top right
   points[2].set(right, bottom); // 2 = bottom right
@@ -106,63 +239,252 @@ void drawBackRightWall(Point *outs, Point *ins)
 
 void drawFrontWall(Point *outs)
 {
-  drawLine(outs[0].X, outs[0].Y, outs[1].X, outs[1].Y);
-  drawLine(outs[1].X, outs[1].Y, outs[2].X, outs[2].Y);
-  drawLine(outs[2].X, outs[2].Y, outs[3].X, outs[3].Y);
-  drawLine(outs[3].X, outs[3].Y, outs[0].X, outs[0].Y);
+  drawRect(outs[0].X, outs[0].Y, outs[2].X, outs[2].Y);
 }
 
 void drawBackWall(Point *ins)
 {
-  drawLine(ins[0].X, ins[0].Y, ins[1].X, ins[1].Y);
-  drawLine(ins[1].X, ins[1].Y, ins[2].X, ins[2].Y);
-  drawLine(ins[2].X, ins[2].Y, ins[3].X, ins[3].Y);
-  drawLine(ins[3].X, ins[3].Y, ins[0].X, ins[0].Y);
+  drawRect(ins[0].X, ins[0].Y, ins[2].X, ins[2].Y);
 }
 
 void drawExit(Point *ins)
 {
-  for (int y = ins[0].Y; y <= ins[2].Y; y++)
+  fillRect(ins[0].X, ins[0].Y, ins[1].X, ins[2].Y);
+}
+
+// Wall primitives pre-rendered at compile time for every depth and zoom step of a straight
+// view, so -DDRAW_MASKS frames are composed with a few row ORs instead of rasterized.
+// Flash cost is MAX_DEPTH * MASK_ZOOM_STEPS * NUM_PRIMITIVES * NUM_ROWS words.
+enum WallPrimitive
+{
+  PRIM_FRONT_LEFT,
+  PRIM_FRONT_RIGHT,
+  PRIM_BACK_LEFT,
+  PRIM_BACK_RIGHT,
+  PRIM_FRONT,
+  PRIM_BACK,
+  PRIM_EXIT,
+  NUM_PRIMITIVES
+};
+
+#define MASK_ZOOM_STEPS (2 * H_INSET) // zoom runs to 2 * H_INSET - 1 when walking out the exit
+
+struct WallMasks
+{
+  rowdata_t rows[MAX_DEPTH][MASK_ZOOM_STEPS][NUM_PRIMITIVES][NUM_ROWS];
+};
+
+// same pixels as drawLine(), in a form the compiler can evaluate
+constexpr void maskLine(rowdata_t *rows, int x0, int y0, int x1, int y1)
+{
+  int dx = x1 - x0, dy = y1 - y0;
+  int sx = dx < 0 ? -1 : 1, sy = dy < 0 ? -1 : 1;
+  int adx = dx < 0 ? -dx : dx, ady = dy < 0 ? -dy : dy;
+  bool xMajor = adx >= ady;
+  int steps = xMajor ? adx : ady;
+  int minor = xMajor ? ady : adx;
+  int error = 0;
+
+  int x = x0, y = y0;
+  for (int i = 0; i <= steps; i++)
   {
-    for (int x = ins[0].X; x <= ins[1].X; x++)
+    if (x >= 0 && x < CLIP_WIDTH && y >= 0 && y < CLIP_HEIGHT)
+      rows[y] |= (rowdata_t)1 << x;
+
+    error += minor;
+    bool stepMinor = error >= steps;
+    if (stepMinor)
+      error -= steps;
+    if (xMajor)
     {
-      if (x >= 0 && x < SCREEN_WIDTH && y >= 0 && y < SCREEN_HEIGHT)
-      {
-        scanSetPixel(x, y, true);
-      }
+      x += sx;
+      y += stepMinor ? sy : 0;
+    }
+    else
+    {
+      y += sy;
+      x += stepMinor ? sx : 0;
     }
   }
 }
 
-void turnRightAnimation(Point *outs, Point *ins)
+constexpr void maskPrimitive(rowdata_t *rows, int primitive, const uint8_t *o, const uint8_t *i)
 {
-  for (byte i = 0; i < 4; i++)
+  // o/i are outer/inner corners as left, top, right, bottom (see CornerTable)
+  switch (primitive)
   {
-    outs[i].X = max(0, outs[i].X - hShift);
-    ins[i].X = max(0, ins[i].X - hShift);
+  case PRIM_FRONT_LEFT:
+    maskLine(rows, o[0], o[1], i[0], i[1]);
+    maskLine(rows, i[0], i[1], i[0], i[3]);
+    maskLine(rows, i[0], i[3], o[0], o[3]);
+    break;
+  case PRIM_FRONT_RIGHT:
+    maskLine(rows, o[2], o[1], i[2], i[1]);
+    maskLine(rows, i[2], i[1], i[2], i[3]);
+    maskLine(rows, i[2], i[3], o[2], o[3]);
+    break;
+  case PRIM_BACK_LEFT:
+    maskLine(rows, o[0], i[1], i[0], i[1]);
+    maskLine(rows, i[0], i[1], i[0], i[3]);
+    maskLine(rows, i[0], i[3], o[0], i[3]);
+    break;
+  case PRIM_BACK_RIGHT:
+    maskLine(rows, o[2], i[1], i[2], i[1]);
+    maskLine(rows, i[2], i[1], i[2], i[3]);
+    maskLine(rows, i[2], i[3], o[2], i[3]);
+    break;
+  case PRIM_FRONT:
+    maskLine(rows, o[0], o[1], o[2], o[1]);
+    maskLine(rows, o[0], o[3], o[2], o[3]);
+    maskLine(rows, o[0], o[1], o[0], o[3]);
+    maskLine(rows, o[2], o[1], o[2], o[3]);
+    break;
+  case PRIM_BACK:
+    maskLine(rows, i[0], i[1], i[2], i[1]);
+    maskLine(rows, i[0], i[3], i[2], i[3]);
+    maskLine(rows, i[0], i[1], i[0], i[3]);
+    maskLine(rows, i[2], i[1], i[2], i[3]);
+    break;
+  case PRIM_EXIT:
+    for (int y = i[1]; y <= i[3]; y++)
+      maskLine(rows, i[0], y, i[2], y);
+    break;
   }
 }
 
-void turnLeftAnimation(Point *outs, Point *ins)
+constexpr WallMasks makeWallMasks()
 {
-  for (byte i = 0; i < 4; i++)
+  WallMasks masks = {};
+  CornerTable corners = makeCornerTable();
+  for (int depth = 0; depth < MAX_DEPTH; depth++)
   {
-    outs[i].X = min(SCREEN_WIDTH, outs[i].X + hShift);
-    ins[i].X = min(SCREEN_WIDTH, ins[i].X + hShift);
+    for (int zoom = 0; zoom < MASK_ZOOM_STEPS; zoom++)
+    {
+      int xOut = SCREEN_HALF_WIDTH - H_INSET * depth + (depth == 0 ? 0 : zoom);
+      int xIn = SCREEN_HALF_WIDTH - H_INSET * (depth + 1) + zoom;
+      const uint8_t *o = corners.corners[xOut < CORNER_TABLE_SIZE ? xOut : CORNER_TABLE_SIZE - 1];
+      const uint8_t *i = corners.corners[xIn < CORNER_TABLE_SIZE ? xIn : CORNER_TABLE_SIZE - 1];
+      for (int primitive = 0; primitive < NUM_PRIMITIVES; primitive++)
+        maskPrimitive(masks.rows[depth][zoom][primitive], primitive, o, i);
+    }
   }
+  return masks;
 }
 
-void drawWalls(byte depth, byte col, byte row)
+const WallMasks wallMasks PROGMEM = makeWallMasks();
+
+// wall flags from the last look*() as a bitmask of WallPrimitive
+uint8_t visiblePrimitives()
+{
+  if (walls.exit)
+    return bit(PRIM_EXIT) | bit(PRIM_FRONT_LEFT) | bit(PRIM_FRONT_RIGHT);
+  if (walls.front)
+    return bit(PRIM_FRONT);
+
+  uint8_t primitives = 0;
+  if (walls.back)
+    primitives |= bit(PRIM_BACK);
+  if (walls.frontLeft)
+    primitives |= bit(PRIM_FRONT_LEFT);
+  else if (walls.backLeft)
+    primitives |= bit(PRIM_BACK_LEFT);
+  if (walls.frontRight)
+    primitives |= bit(PRIM_FRONT_RIGHT);
+  else if (walls.backRight)
+    primitives |= bit(PRIM_BACK_RIGHT);
+  return primitives;
+}
+
+// OR the masks for a straight view into the back buffer, false if the state has no masks
+bool composeWalls(byte depth, uint8_t primitives)
+{
+  if (zoom >= MASK_ZOOM_STEPS)
+    return false;
+
+  const rowdata_t *masks[NUM_PRIMITIVES];
+  uint8_t count = 0;
+  for (uint8_t primitive = 0; primitive < NUM_PRIMITIVES; primitive++)
+  {
+    if (primitives & bit(primitive))
+      masks[count++] = wallMasks.rows[depth][zoom][primitive];
+  }
+
+  for (uint8_t row = 0; row < NUM_ROWS; row++)
+  {
+    rowdata_t rowData = 0;
+    for (uint8_t i = 0; i < count; i++)
+      rowData |= readRowData(masks[i] + row);
+    if (rowData)
+      scanOrRow(row, rowData);
+  }
+  return true;
+}
+
+void rasterWalls(byte depth, uint8_t primitives)
 {
   Point outs[4], ins[4];
   xToCorners(SCREEN_HALF_WIDTH - H_INSET * depth + (depth == 0 ? 0 : zoom), outs);
   xToCorners(SCREEN_HALF_WIDTH - H_INSET * (depth + 1) + zoom, ins);
 
-  if (playerRotation == LEFT)
-    turnLeftAnimation(outs, ins);
-  if (playerRotation == RIGHT)
-    turnRightAnimation(outs, ins);
+  if (primitives & bit(PRIM_EXIT))
+    drawExit(ins);
+  if (primitives & bit(PRIM_FRONT))
+    drawFrontWall(outs);
+  if (primitives & bit(PRIM_BACK))
+    drawBackWall(ins);
+  if (primitives & bit(PRIM_FRONT_LEFT))
+    drawFrontLeftWall(outs, ins);
+  if (primitives & bit(PRIM_BACK_LEFT))
+    drawBackLeftWall(outs, ins);
+  if (primitives & bit(PRIM_FRONT_RIGHT))
+    drawFrontRightWall(outs, ins);
+  if (primitives & bit(PRIM_BACK_RIGHT))
+    drawBackRightWall(outs, ins);
+}
+
+// nearer walls are brighter; with 1-bit scan everything is full on
+inline uint8_t depthIntensity(byte depth)
+{
+  int8_t intensity = MAX_INTENSITY - depth * ((MAX_INTENSITY + 1) / MAX_DEPTH);
+  return intensity < 1 ? 1 : intensity;
+}
 
+// everything that decides a frame's pixels; equal signatures render identical frames
+struct ViewSignature
+{
+#if defined(DRAW_RAYCAST)
+  int8_t row, col; // rays see past MAX_DEPTH, so the view is keyed on the pose itself
+  uint8_t heading;
+#else
+  uint8_t primitives[MAX_DEPTH]; // visiblePrimitives() per depth, 0 past the first blocking wall
+#endif
+  uint8_t zoom;
+  uint8_t hShift;
+  int8_t rotation;
+};
+
+ViewSignature lastView;
+bool lastViewValid = false; // cleared when something other than drawMaze() publishes a frame
+
+// A turn is a horizontal slide from the view along playerHeading to the view along the turned
+// heading. The incoming view is drawn once when the turn starts and kept in turnView, panel 0 of
+// each plane; each turn frame draws the outgoing view into the back buffer as a straight frame
+// would, then shifts the two apart by hShift columns and ORs them, a few word ops per row.
+#if defined(MAZE_ENDLESS)
+rowdata_t turnView[NUM_PLANES * NUM_ROWS];
+#else
+rowdata_t *const turnView = mazeScratch.turnView; // nothing navigates during a turn, see maze.h
+#endif
+bool turnViewValid = false; // cleared by startTurn(), straight frames and invalidateView()
+
+void invalidateView()
+{
+  lastViewValid = false;
+  turnViewValid = false;
+}
+
+void lookAt(byte depth, byte col, byte row)
+{
   if (playerHeading == NORTH)
     lookNorth(row - depth, col);
   if (playerHeading == EAST)
@@ -171,44 +493,296 @@ void drawWalls(byte depth, byte col, byte row)
     lookSouth(row + depth, col);
   if (playerHeading == WEST)
     lookWest(row, col - depth);
+}
+
+// Raycaster, used by drawMaze() with -DDRAW_RAYCAST: one ray per screen column walks MAZE with an
+// integer DDA until it hits a wall cell, so side openings and long halls out to RAY_MAX_DEPTH
+// cells show up. Rays run in the player's frame (forward, right), where the step length per
+// lateral cell is a per-column constant from a compile-time table and the forward one is a
+// whole cell, so a frame costs at most SCREEN_WIDTH * RAY_MAX_STEPS grid steps and no division.
+// Walls are drawn as outlines like the primitive renderer: top and bottom edge per column plus a
+// vertical edge wherever the ray moves onto a different wall plane.
+#define RAY_MAX_DEPTH 12                                        // cells, further walls round to 0 px
+#define RAY_MAX_STEPS (2 * RAY_MAX_DEPTH)                        // forward plus lateral cells crossed
+#define RAY_PLANE 0.6667f                                       // tan of half the field of view
+#define RAY_HALF_HEIGHT (SCREEN_HALF_HEIGHT * 0.5f / RAY_PLANE) // px, half a wall one cell away
+#define RAY_FAR (RAY_MAX_DEPTH << 8)
+#define RAY_MISS 0xFFFF
+
+struct RayTable
+{
+  uint16_t lateralDelta[SCREEN_WIDTH];          // 8.8 distance per lateral cell crossed
+  uint16_t halfThreshold[SCREEN_HALF_HEIGHT + 1]; // furthest 8.8 distance still h px half-height
+};
 
-  if (hasExit)
+constexpr RayTable makeRayTable()
+{
+  RayTable table = {};
+  for (int x = 0; x < SCREEN_WIDTH; x++)
   {
-    drawExit(ins);
-    drawFrontLeftWall(outs, ins);
-    drawFrontRightWall(outs, ins);
+    float lateral = RAY_PLANE * (2 * x + 1 - SCREEN_WIDTH) / SCREEN_WIDTH;
+    float delta = 256 / (lateral < 0 ? -lateral : lateral);
+    table.lateralDelta[x] = delta > RAY_FAR ? RAY_FAR : (uint16_t)delta;
   }
-  else if (hasFrontWall)
+  table.halfThreshold[0] = RAY_MISS;
+  for (int h = 1; h <= SCREEN_HALF_HEIGHT; h++)
+    table.halfThreshold[h] = (uint16_t)(RAY_HALF_HEIGHT * 512 / (2 * h - 1)); // rounds to nearest
+  return table;
+}
+
+const RayTable rayTable PROGMEM = makeRayTable();
+
+const int8_t rayHeadings[NUM_DIRECTIONS][2] = {{-1, 0}, {0, 1}, {1, 0}, {0, -1}}; // row, col per Direction
+
+struct RayHit
+{
+  uint16_t distance; // 8.8 cells along the view direction, RAY_MISS if nothing within RAY_MAX_DEPTH
+  uint16_t plane;    // wall plane hit, lateral planes have the high byte set
+};
+
+// ray for view column `column` from `forward` (8.8 cells) ahead of the back edge of the player's cell
+RayHit castRay(uint8_t column, uint16_t forward)
+{
+  const int8_t *ahead = rayHeadings[playerHeading];
+  const int8_t *right = rayHeadings[turnRight(playerHeading)];
+  int8_t side = column < SCREEN_HALF_WIDTH ? -1 : 1;
+  uint16_t lateralDelta = pgm_read_word(&rayTable.lateralDelta[column]);
+
+  int8_t row = playerRow + ahead[0] * (forward >> 8);
+  int8_t col = playerCol + ahead[1] * (forward >> 8);
+  uint16_t forwardNext = 256 - (forward & 0xFF); // distance to the next forward cell boundary
+  uint16_t lateralNext = lateralDelta / 2;        // the camera is centred across its cell
+  uint8_t forwardCells = 0, lateralCells = 0;
+
+  for (uint8_t step = 0; step < RAY_MAX_STEPS; step++)
   {
-    drawFrontWall(outs);
+    RayHit hit;
+    if (forwardNext <= lateralNext)
+    {
+      hit.distance = forwardNext;
+      hit.plane = ++forwardCells;
+      forwardNext += 256;
+      row += ahead[0];
+      col += ahead[1];
+    }
+    else
+    {
+      hit.distance = lateralNext;
+      hit.plane = 0x100 | ++lateralCells;
+      lateralNext += lateralDelta;
+      row += right[0] * side;
+      col += right[1] * side;
+    }
+
+    if (hit.distance >= RAY_FAR)
+      break;
+    if (isWall(row, col))
+      return hit;
   }
-  else
+  return {RAY_MISS, RAY_MISS};
+}
+
+uint8_t rayHalfHeight(uint16_t distance)
+{
+  uint8_t half = 0;
+  while (half < SCREEN_HALF_HEIGHT && distance <= pgm_read_word(&rayTable.halfThreshold[half + 1]))
+    half++;
+  return half;
+}
+
+inline uint8_t rayIntensity(uint16_t distance)
+{
+  uint8_t cells = distance >> 8;
+  return depthIntensity(cells < MAX_DEPTH ? cells : MAX_DEPTH - 1);
+}
+
+void drawRaycast()
+{
+  uint16_t forward = zoom * 256 / H_INSET;
+
+  RayHit last = {RAY_MISS, RAY_MISS};
+  uint8_t lastHalf = 0;
+  for (int8_t x = 0; x < CLIP_WIDTH; x++)
   {
-    if (hasBackWall)
-      drawBackWall(ins);
+    RayHit hit = castRay(x, forward);
+    uint8_t half = rayHalfHeight(hit.distance);
 
-    if (hasFrontLeftWall)
-      drawFrontLeftWall(outs, ins);
-    else if (hasBackLeftWall)
-      drawBackLeftWall(outs, ins);
+    if (x > 0 && hit.plane != last.plane)
+    {
+      // edge between two planes (or a plane and an opening), drawn on the nearer one
+      if (half && half >= lastHalf)
+      {
+        scanSetIntensity(rayIntensity(hit.distance));
+        drawVLine(x, Y0 - half, Y0 + half - 1);
+      }
+      else if (lastHalf)
+      {
+        scanSetIntensity(rayIntensity(last.distance));
+        drawVLine(x - 1, Y0 - lastHalf, Y0 + lastHalf - 1);
+      }
+    }
+
+    if (half)
+    {
+      // top and bottom outline, joined to the previous column along the same plane
+      uint8_t join = hit.plane == last.plane ? lastHalf : half;
+      scanSetIntensity(rayIntensity(hit.distance));
+      drawVLine(x, Y0 - half, Y0 - join);
+      drawVLine(x, Y0 + half - 1, Y0 + join - 1);
+    }
 
-    if (hasFrontRightWall)
-      drawFrontRightWall(outs, ins);
-    else if (hasBackRightWall)
-      drawBackRightWall(outs, ins);
+    last = hit;
+    lastHalf = half;
   }
 }
 
-void drawMaze()
+void drawWalls(byte depth, uint8_t primitives)
+{
+  PROFILE_SCOPE(PROFILE_DRAW_WALLS);
+  scanSetIntensity(depthIntensity(depth));
+
+#if defined(DRAW_MASKS)
+  if (composeWalls(depth, primitives))
+    return;
+#endif
+  rasterWalls(depth, primitives);
+}
+
+// top-down view of the maze, shown while it is being carved
+void drawMazeMap()
 {
+  int8_t top = (CLIP_HEIGHT - MAZE_HEIGHT) / 2;
   scanClear();
+  for (byte row = 0; row < MAZE_HEIGHT; row++)
+  {
+    if (row + top < 0 || row + top >= CLIP_HEIGHT)
+      continue;
+    rowdata_t rowData = 0;
+    for (byte col = 0; col < MAZE_WIDTH && col < CLIP_WIDTH; col++)
+    {
+      if (MAZE.get(row, col))
+        rowData |= pixelMask(col);
+    }
+    scanOrRow(row + top, rowData);
+  }
+  scanShow();
+  invalidateView();
+}
 
+ViewSignature viewSignature()
+{
+  ViewSignature view = {};
+#if defined(DRAW_RAYCAST)
+  view.row = playerRow;
+  view.col = playerCol;
+  view.heading = playerHeading;
+#else
   for (byte depth = 0; depth < MAX_DEPTH; depth++)
   {
-    drawWalls(depth, playerCol, playerRow);
-    if (hasFrontWall || hasBackWall || hasExit)
+    lookAt(depth, playerCol, playerRow);
+    view.primitives[depth] = visiblePrimitives();
+    if (walls.front || walls.back || walls.exit)
       break;
   }
+#endif
+  view.zoom = zoom;
+  view.hShift = hShift;
+  view.rotation = playerRotation;
+  return view;
+}
+
+// the straight view of `view` into the cleared back buffer
+void drawView(const ViewSignature &view)
+{
+#if defined(DRAW_RAYCAST)
+  (void)view; // the signature holds the pose, which drawRaycast() reads itself
+  drawRaycast();
+#else
+  for (byte depth = 0; depth < MAX_DEPTH; depth++)
+  {
+    if (view.primitives[depth])
+      drawWalls(depth, view.primitives[depth]);
+  }
+#endif
+}
+
+// the straight view along `heading` into the cleared back buffer
+void drawTurnView(Direction heading)
+{
+  Direction currentHeading = playerHeading;
+  Rotation rotation = playerRotation;
+  playerHeading = heading;
+  playerRotation = NO_ROT;
+
+  scanClear();
+  drawView(viewSignature());
+
+  playerHeading = currentHeading;
+  playerRotation = rotation;
+}
+
+// turning right slides the old view out to the left (towards bit 0) and the new one in from the
+// right, turning left the other way round
+void composeTurn()
+{
+  if (!turnViewValid)
+  {
+#if !defined(MAZE_ENDLESS)
+    exitFieldValid = false;
+#endif
+    drawTurnView(playerRotation == RIGHT ? turnRight(playerHeading) : turnLeft(playerHeading));
+    for (uint8_t plane = 0; plane < NUM_PLANES; plane++)
+      memcpy(turnView + plane * NUM_ROWS, drawBuffer + plane * Matrix::PlaneWords, NUM_ROWS * sizeof(rowdata_t));
+    turnViewValid = true;
+  }
+
+  drawTurnView(playerHeading);
+  uint8_t s = hShift < CLIP_WIDTH ? hShift : CLIP_WIDTH;
+  rowdata_t clip = spanMask(0, CLIP_WIDTH - 1);
+  for (uint8_t plane = 0; plane < NUM_PLANES; plane++)
+  {
+    const rowdata_t *to = turnView + plane * NUM_ROWS;
+    rowdata_t *rows = drawBuffer + plane * Matrix::PlaneWords;
+    for (uint8_t row = 0; row < NUM_ROWS; row++)
+    {
+      rowdata_t from = rows[row];
+      rowdata_t rowData;
+      if (s == 0)
+        rowData = from;
+      else if (s == CLIP_WIDTH)
+        rowData = to[row];
+      else if (playerRotation == RIGHT)
+        rowData = (rowdata_t)(from >> s) | (rowdata_t)(to[row] << (CLIP_WIDTH - s));
+      else
+        rowData = (rowdata_t)(from << s) | (rowdata_t)(to[row] >> (CLIP_WIDTH - s));
+      rows[row] = rowData & clip;
+    }
+  }
+}
+
+// returns false when the view is unchanged since the last published frame and nothing was drawn
+bool drawMaze()
+{
+  PROFILE_SCOPE(PROFILE_DRAW_MAZE);
+  ViewSignature view = viewSignature();
+
+  if (lastViewValid && memcmp(&view, &lastView, sizeof(view)) == 0)
+    return false;
+  lastView = view;
+  lastViewValid = true;
+
+  if (playerRotation != NO_ROT)
+  {
+    composeTurn();
+  }
+  else
+  {
+    turnViewValid = false;
+    scanClear();
+    drawView(view);
+  }
 
+  scanSetIntensity(MAX_INTENSITY);
   scanShow();
+  return true;
 }
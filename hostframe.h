@@ -0,0 +1,72 @@
+#pragma once
+
+#include <Arduino.h>
+#include <Wire.h>
+
+#include "scan.h"
+
+// Host frame streaming: the I2C master writes rows straight from the Wire buffer into the scan
+// back buffer and commits them with a single publish, while the maze renderer is suspended.
+// Row words are sent MSB first. The render task hands the back buffer over at a frame boundary,
+// so writes that arrive before hostFrames is set are dropped.
+//
+// At 400 kHz a 16x16 frame is two 19-byte row writes plus a 3-byte commit, about 1 ms of bus
+// time, so the wire rather than the copy limits the rate (~900 fps, 8x8 ~2000 fps).
+// On a chained wall row numbers continue panel after panel (see scanSetRow()), so the maze view
+// stays on panel 0 while host frames can fill every panel.
+#define HOST_ROW_BYTES ((uint8_t)sizeof(rowdata_t))
+
+volatile bool hostFramesRequested = false; // set over I2C
+volatile bool hostFrames = false;           // back buffer belongs to the host, renderer suspended
+
+// raw rows from `row` on, as many as the message holds
+void hostFrameWriteRows(uint8_t row, int bytes)
+{
+  if (!hostFrames)
+    return;
+
+  for (; bytes >= HOST_ROW_BYTES && row < Matrix::PlaneWords; bytes -= HOST_ROW_BYTES, row++)
+  {
+    rowdata_t rowData = Wire.read();
+    if (HOST_ROW_BYTES > 1)
+      rowData = (rowData << 8) | Wire.read();
+    scanSetRow(row, rowData);
+  }
+}
+
+// (count, value) byte pairs that expand into the same byte stream as hostFrameWriteRows()
+void hostFrameWriteRowsRle(uint8_t row, int bytes)
+{
+  if (!hostFrames)
+    return;
+
+  rowdata_t rowData = 0;
+  uint8_t rowBytes = 0;
+  for (; bytes >= 2; bytes -= 2)
+  {
+    uint8_t count = Wire.read();
+    uint8_t value = Wire.read();
+    for (; count > 0 && row < Matrix::PlaneWords; count--)
+    {
+      rowData = (rowData << 8) | value;
+      if (++rowBytes == HOST_ROW_BYTES)
+      {
+        scanSetRow(row++, rowData);
+        rowBytes = 0;
+      }
+    }
+  }
+}
+
+// publish the back buffer and carry the frame over, so later writes can update just a few rows
+void hostFrameCommit()
+{
+  if (!hostFrames)
+    return;
+
+  rowdata_t *committed = drawBuffer;
+  scanPublish();
+  memcpy(drawBuffer, committed, sizeof(frameBuffers[0]));
+  if (scanOrientation)
+    scanOrientFrame(drawBuffer, scanInverseOrientation(scanOrientation)); // publishing oriented it in place
+}
@@ -3,31 +3,82 @@
 #include <Wire.h>
 
 #include "draw.h"
+#include "hostframe.h"
 #include "maze.h"
 #include "player.h"
 #include "scan.h"
+#include "scheduler.h"
+#include "telemetry.h"
 
 #define I2C_ADDRESS 0x15
 #define STATUS_LED_PIN 5
 #define STATUS_UPDATE_INTERVAL 500
+#define SCAN_TEST_DURATION 2000 // all-on test frame at boot before the first maze
+#define RESET_PAUSE 1000        // hold the exit view before carving the next maze
+#define MAZE_GEN_BUDGET 8       // generator iterations per scheduler tick
+#define PROFILE_REPORT_INTERVAL 5000 // -DPROFILE: region timings to the debug UART
+
+// I2C commands, first byte of every message
+#define CMD_SET_DISPLAY 0x00     // enabled
+#define CMD_HOST_FRAMES 0x01     // enabled: suspend the maze and take frames from the host
+#define CMD_WRITE_ROWS 0x02      // start row, row words MSB first
+#define CMD_WRITE_ROWS_RLE 0x03  // start row, (count, byte) pairs of the same stream
+#define CMD_COMMIT_FRAME 0x04    // any byte, publishes the written frame
+#define CMD_READ_TELEMETRY 0x05  // register offset for the next read, see telemetry.h
+#define CMD_SET_SEED 0x06        // 32-bit seed little endian, 0 for random: regenerates the maze
+#define CMD_SET_ORIENTATION 0x07 // quarter turns in bits 1..0, mirror H/V in bits 2/3, see scan.h
+#define CMD_SET_REFRESH 0x08     // 16-bit frames per second little endian, blank window in us
+#define CMD_SET_NAVIGATION 0x09  // NavigationMode, see player.h
 
 // display state
 volatile bool display = true;
 
+enum TaskId
+{
+  TASK_STATUS_LED,
+  TASK_PLAYER,
+  TASK_ANIMATION,
+  TASK_RENDER,
+  TASK_GENERATE,
+#if defined(PROFILE)
+  TASK_PROFILE,
+#endif
+  NUM_TASKS
+};
+
+uint16_t resetPause = 0;
+volatile bool seedChanged = false; // set over I2C, the generate task restarts the maze
+
 // i2c
 unsigned long lastStatusLedUpdate = 0;
-unsigned long statusLedUpdateInterval = STATUS_UPDATE_INTERVAL;
+uint16_t statusLedUpdateInterval = STATUS_UPDATE_INTERVAL;
 bool statusLedState = false;
 bool statusLedFirstBlink = false;
 uint8_t statusLedBlinks = 0; // number of extra short blinks after long "ACK" blink
 
 void handleOnReceive(int bytesReceived)
 {
+  // frame data and telemetry polls come at a high rate, keep them short and off the status LED
+  if (bytesReceived >= 2 && Wire.peek() >= CMD_WRITE_ROWS && Wire.peek() <= CMD_READ_TELEMETRY)
+  {
+    uint8_t command = Wire.read();
+    if (command == CMD_WRITE_ROWS)
+      hostFrameWriteRows(Wire.read(), bytesReceived - 2);
+    else if (command == CMD_WRITE_ROWS_RLE)
+      hostFrameWriteRowsRle(Wire.read(), bytesReceived - 2);
+    else if (command == CMD_COMMIT_FRAME)
+      hostFrameCommit();
+    else
+      telemetrySelect(Wire.read());
+    return;
+  }
+
   statusLedState = true;
   digitalWrite(STATUS_LED_PIN, !statusLedState);
   lastStatusLedUpdate = millis();
   statusLedBlinks = 0;
   statusLedFirstBlink = true;
+  taskWake(TASK_STATUS_LED);
 
   if (bytesReceived < 2)
   {
@@ -38,10 +89,55 @@ void handleOnReceive(int bytesReceived)
   statusLedBlinks = command + 1; // use value to blink status LED
 
   // setDisplay
-  if (command == 0x00)
+  if (command == CMD_SET_DISPLAY)
   {
     display = Wire.read();
     scanDisplay(display);
+    taskWake(TASK_PLAYER);
+    taskWake(TASK_ANIMATION);
+    taskWake(TASK_RENDER);
+  }
+  // setHostFrames, the render task does the handover
+  else if (command == CMD_HOST_FRAMES)
+  {
+    hostFramesRequested = Wire.read();
+    taskWake(TASK_RENDER);
+  }
+  // setSeed, replay a maze from its telemetry seed or pin every maze to one seed; short messages
+  // are ignored
+  else if (command == CMD_SET_SEED)
+  {
+    if (bytesReceived < 5)
+      return;
+    uint32_t seed = 0;
+    for (uint8_t i = 0; i < 4; i++)
+      seed |= (uint32_t)(uint8_t)Wire.read() << (8 * i);
+    rngSeedOverride = seed;
+    seedChanged = true;
+    taskWake(TASK_GENERATE);
+  }
+  // setOrientation, redraw so an unchanged view picks it up
+  else if (command == CMD_SET_ORIENTATION)
+  {
+    scanSetOrientation(Wire.read());
+    invalidateView();
+    taskWake(TASK_RENDER);
+  }
+  // setRefresh, trade flicker against ISR load (telemetry isrLoad); short messages are ignored
+  else if (command == CMD_SET_REFRESH)
+  {
+    if (bytesReceived < 4)
+      return;
+    uint16_t hz = (uint8_t)Wire.read();
+    hz |= (uint16_t)(uint8_t)Wire.read() << 8;
+    scanSetRefresh(hz, Wire.read());
+  }
+  // setNavigation, the player follows it from its next step; unknown modes are ignored
+  else if (command == CMD_SET_NAVIGATION)
+  {
+    uint8_t mode = Wire.read();
+    if (mode <= NAV_EXPLORE)
+      navigationMode = (NavigationMode)mode;
   }
   else
   {
@@ -79,24 +175,172 @@ void updateStatusLed() {
   }
 }
 
+uint16_t statusLedTask()
+{
+  updateStatusLed();
+  if (statusLedBlinks == 0 && !statusLedState)
+    return TASK_IDLE; // woken by the next I2C message
+  return msUntil(lastStatusLedUpdate + statusLedUpdateInterval + 1);
+}
+
+void requestMazeReset(uint16_t pause)
+{
+  resetPause = pause;
+  mazeGenBegin();
+  taskWake(TASK_GENERATE);
+}
+
+uint16_t playerTask()
+{
+  if (!display || hostFrames || !playerIdle() || mazeGen.active)
+    return TASK_IDLE; // woken by setDisplay, host frames ending or the animation/generation finishing
+
+  if (updatePlayer())
+  {
+    if (playerMoveDirection != NO_DIR)
+      telemetryStep();
+    taskWake(TASK_ANIMATION);
+    taskWake(TASK_RENDER);
+  }
+  return msUntil(playerLastMoved + 1);
+}
+
+uint16_t animationTask()
+{
+  if (!display || hostFrames)
+    return TASK_IDLE;
+
+  if (updateAnimation())
+    taskWake(TASK_RENDER);
+
+  if (playerExited)
+  {
+    playerExited = false;
+    telemetryMazeCompleted();
+    requestMazeReset(RESET_PAUSE);
+    return TASK_IDLE;
+  }
+
+  if (playerIdle())
+  {
+    taskWake(TASK_PLAYER);
+    return TASK_IDLE;
+  }
+  return msUntil(timeToMove + 1);
+}
+
+uint16_t renderTask()
+{
+  // hand the back buffer to or from the host between frames, never mid-render
+  bool requested = hostFramesRequested;
+  if (requested != hostFrames)
+  {
+    if (requested)
+    {
+      scanClear(); // before hostFrames opens the buffer, so no early host row is wiped
+      hostFrames = true;
+    }
+    else
+    {
+      hostFrames = false;
+      invalidateView();
+      taskWake(TASK_PLAYER);
+      taskWake(TASK_ANIMATION);
+    }
+  }
+
+  if (display && !hostFrames && !mazeGen.active)
+  {
+    unsigned long start = micros();
+    if (drawMaze())
+      telemetryDrawMaze(micros() - start);
+  }
+  return TASK_IDLE; // woken by whatever changed the view
+}
+
+uint16_t generateTask()
+{
+  if (seedChanged)
+  {
+    seedChanged = false;
+    stopPlayer();
+    requestMazeReset(0);
+  }
+
+  if (!mazeGen.active)
+    return TASK_IDLE;
+
+  if (resetPause)
+  {
+    uint16_t pause = resetPause;
+    resetPause = 0;
+    return pause;
+  }
+
+  unsigned long start = micros();
+  bool done = stepMazeReset(MAZE_GEN_BUDGET);
+  telemetryGenerateMaze(micros() - start, done);
+  if (!done)
+  {
+#if defined(MAZE_GEN_ANIMATION)
+    if (display && !hostFrames)
+      drawMazeMap();
+#endif
+    return 0; // more to carve, continue next tick
+  }
+
+  invalidateView();
+  taskWake(TASK_PLAYER);
+  taskWake(TASK_RENDER);
+  return TASK_IDLE;
+}
+
+#if defined(PROFILE)
+uint16_t profileTask()
+{
+  PROFILE_REPORT();
+  return PROFILE_REPORT_INTERVAL;
+}
+#endif
+
+const task_fn_t taskRun[NUM_TASKS] = {
+    statusLedTask,
+    playerTask,
+    animationTask,
+    renderTask,
+    generateTask,
+#if defined(PROFILE)
+    profileTask,
+#endif
+};
+
+Task tasks[NUM_TASKS] = {
+    {0},
+    {0},
+    {0},
+    {0},
+    {0},
+#if defined(PROFILE)
+    {PROFILE_REPORT_INTERVAL},
+#endif
+};
+
 void setup(void)
 {
+  taskWaitMask = bit(TASK_GENERATE); // until the first maze reset wakes it
   Wire.begin(I2C_ADDRESS);
   Wire.onReceive(handleOnReceive);
+  Wire.onRequest(telemetryRequest);
+  PROFILE_INIT();
 
   scanInit();
   scanDisplay(true);
   scanTest();
-  
-  resetMaze();
+
+  requestMazeReset(SCAN_TEST_DURATION);
 }
 
 void loop(void)
 {
-  updateStatusLed();
-
-  if (display && move())
-  {
-    drawMaze();
-  }
+  schedulerRun(taskRun, tasks, NUM_TASKS);
 }
@@ -2,7 +2,12 @@
 
 #include <Arduino.h>
 
-enum Direction {
+#include "bitgrid.h"
+#include "profile.h"
+#include "rng.h"
+#include "scan.h"
+
+enum Direction : uint8_t {
   NORTH = 0,
   EAST = 1,
   SOUTH = 2,
@@ -10,14 +15,19 @@ enum Direction {
   NO_DIR = 4
 };
 
-enum Rotation {
+enum Rotation : int8_t {
   LEFT = -1,
   NO_ROT = 0,
   RIGHT = 1
 };
 
+// any width from 3 to 32 works, rows are stored in the smallest word that fits
+#ifndef MAZE_WIDTH
 #define MAZE_WIDTH 16
+#endif
+#ifndef MAZE_HEIGHT
 #define MAZE_HEIGHT 9
+#endif
 #define NUM_DIRECTIONS 4
 
 inline Direction turnLeft(Direction dir) {
@@ -43,7 +53,10 @@ inline Direction getOppositeDirection(Direction dir) {
 //   0b1111111111111111,
 //   0b1111111111111111,
 // };
-uint16_t MAZE[MAZE_HEIGHT] = {
+typedef BitGrid<MAZE_WIDTH, MAZE_HEIGHT> MazeGrid;
+
+#if MAZE_WIDTH == 16 && MAZE_HEIGHT == 9
+MazeGrid MAZE = {{
   0b1111111111111111,
   0b1000000000000001,
   0b1111111110000001,
@@ -53,105 +66,274 @@ uint16_t MAZE[MAZE_HEIGHT] = {
   0b1000000000000111,
   0b1111111111111111,
   0b1111111111111111,
-};
+}};
+#else
+MazeGrid MAZE; // filled by generateMaze()
+#endif
 
 
 // Forward declarations for player variables
-extern int playerRow, playerCol;
+extern int8_t playerRow, playerCol;
 extern Direction playerHeading;
 
 // Maze generation variables
-int startRow, startCol;
+byte startRow, startCol;
+
+// walls around the cell lookAt() inspected, relative to the player's heading
+struct WallFlags {
+  bool frontLeft : 1;
+  bool front : 1;
+  bool frontRight : 1;
+  bool backLeft : 1;
+  bool back : 1;
+  bool backRight : 1;
+  bool exit : 1;
+};
+
+WallFlags walls;
+
+void carveCell(byte row, byte col) {
+  MAZE.clear(row, col);
+}
+
+bool inBounds(byte row, byte col) {
+  return row > 0 && row < MAZE_HEIGHT - 1 && col > 0 && col < MAZE_WIDTH - 1;
+}
+
+bool isCarved(byte row, byte col) {
+  return !MAZE.get(row, col);
+}
 
-bool hasFrontLeftWall;
-bool hasFrontWall;
-bool hasFrontRightWall;
-bool hasBackLeftWall;
-bool hasBackWall;
-bool hasBackRightWall;
-bool hasExit;
+// Generation is resumable: mazeGenBegin() arms it and each mazeGenStep(budget) call does at most
+// `budget` units of work (one backtracker iteration or one streamed row), so a reset can be
+// spread across scheduler ticks instead of blocking. generateMaze() runs it to completion.
+struct MazeGenState {
+  bool active;
+  bool started;
+  byte row, col;
+  uint8_t directionOrder; // backtracker: four 2-bit indices into genDirections, first in bits 1..0
+  uint16_t safetyCounter;
+};
 
+MazeGenState mazeGen;
+
+void mazeGenBegin() {
+  mazeGen.active = true;
+  mazeGen.started = false;
+  mazeSeed = rngNextSeed();
+  rngSeed(mazeSeed);
+}
+
+#if defined(MAZE_ENDLESS)
+// Endless mode streams the maze southwards one cell row at a time and only keeps the
+// MAZE_HEIGHT-row window around the player; rows that scroll off the top are walled over.
+// Each row is carved into random horizontal runs and every run opens exactly one passage
+// down (Eller's algorithm where each run is its own set, so no set labels are kept). That
+// never closes a loop and always leaves a way south that doesn't need the dropped rows.
+#define MAZE_CELLS ((MAZE_WIDTH - 1) / 2) // cells sit on odd columns
+
+// carve cell row `row` and randomly join neighbouring cells into runs
+void carveRow(byte row) {
+  for (byte c = 0; c < MAZE_CELLS; c++) {
+    carveCell(row, 2 * c + 1);
+    if (c + 1 < MAZE_CELLS && rngBelow(2)) carveCell(row, 2 * c + 2);
+  }
+}
+
+// open one passage down from each run of cell row `row`, then carve cell row `row + 2`
+void extendMaze(byte row) {
+  byte runStart = 0;
+  for (byte c = 0; c < MAZE_CELLS; c++) {
+    if (c + 1 < MAZE_CELLS && isCarved(row, 2 * c + 2)) continue;
+
+    carveCell(row + 1, 2 * (runStart + rngBelow(c - runStart + 1)) + 1);
+    runStart = c + 1;
+  }
+  carveRow(row + 2);
+}
+
+// drop the top two rows and generate two more below, keeping the player in the window middle
+void scrollMaze() {
+  for (byte i = 0; i < MAZE_HEIGHT - 2; i++) MAZE[i] = MAZE[i + 2];
+  MAZE[0] = MazeGrid::FULL;
+  MAZE[MAZE_HEIGHT - 2] = MazeGrid::FULL;
+  MAZE[MAZE_HEIGHT - 1] = MazeGrid::FULL;
+  extendMaze(MAZE_HEIGHT - 4);
+  playerRow -= 2;
+}
+
+bool mazeGenStep(uint8_t budget) {
+  PROFILE_SCOPE(PROFILE_MAZE_GEN);
+  if (!mazeGen.started) {
+    MAZE.fill();
+    startRow = 1;
+    startCol = 1;
+
+    carveRow(1);
+    mazeGen.row = 1;
+    mazeGen.started = true;
+  }
+
+  for (; budget > 0 && mazeGen.row + 2 < MAZE_HEIGHT - 1; budget--, mazeGen.row += 2) extendMaze(mazeGen.row);
+
+  mazeGen.active = mazeGen.row + 2 < MAZE_HEIGHT - 1;
+  return !mazeGen.active;
+}
+#else
 // Global stack to avoid stack overflow - uses static allocation
-#define MAX_STACK_SIZE 32
+#define MAX_STACK_SIZE (((MAZE_WIDTH - 1) / 2) * ((MAZE_HEIGHT - 1) / 2) + 1) // every cell plus the start pushed twice
 struct Stack {
-  byte data[MAX_STACK_SIZE][2];
-  int top;
-  
-  void push(byte r, byte c) { 
+  // cells as row * MAZE_WIDTH + col, one byte each up to 256 cells
+  typedef typename GridWord<(MAZE_WIDTH * MAZE_HEIGHT <= 256), true>::type cell_t;
+  // entry count, one byte up to 255 entries
+  typedef typename GridWord<(MAX_STACK_SIZE <= 255), true>::type index_t;
+  cell_t data[MAX_STACK_SIZE];
+  index_t top;
+
+  void push(byte r, byte c) {
     if (top < MAX_STACK_SIZE) {
-      data[top][0] = r; 
-      data[top][1] = c; 
-      top++; 
+      data[top++] = r * MAZE_WIDTH + c;
     }
   }
-  void pop(byte& r, byte& c) { 
+  void pop(byte& r, byte& c) {
     if (top > 0) {
-      top--; 
-      r = data[top][0]; 
-      c = data[top][1]; 
+      cell_t cell = data[--top];
+      r = cell / MAZE_WIDTH;
+      c = cell % MAZE_WIDTH;
     }
   }
   bool empty() { return top == 0; }
   bool full() { return top >= MAX_STACK_SIZE; }
 };
 
-// Global stack instance to avoid stack allocation
-Stack mazeGenStack;
+// Heading that leads one step closer to the exit for every open cell, as two bitplanes
+// (bit 0 = EAST/WEST, bit 1 = SOUTH/WEST, matching Direction). Filled by a breadth-first
+// search from the exit that expands whole frontier rows with shifts and masks per level.
+struct ExitField {
+  MazeGrid lo, hi;
+};
 
-void carveCell(byte row, byte col) {
-  MAZE[row] &= ~(1 << ((MAZE_WIDTH - 1) - col));
-}
+// The backtracker stack is only live while carving and the exit field is only filled once the
+// stack has emptied, so they share storage; the player must not navigate while a maze is carved.
+// A turn animation doesn't navigate either, so it borrows the storage for the incoming view (see
+// composeTurn() in draw.h) and the exit field is solved again on the next exitHeading().
+union MazeScratch {
+  Stack genStack;
+  ExitField exitDir;
+  rowdata_t turnView[NUM_PLANES * NUM_ROWS];
+};
 
-bool inBounds(byte row, byte col) {
-  return row > 0 && row < MAZE_HEIGHT - 1 && col > 0 && col < MAZE_WIDTH - 1;
+MazeScratch mazeScratch;
+bool exitFieldValid = false; // mazeScratch holds the exit field
+
+void solveMaze() {
+  MazeGrid::row_t frontier[MAZE_HEIGHT], visited[MAZE_HEIGHT];
+  for (byte r = 0; r < MAZE_HEIGHT; r++) {
+    frontier[r] = visited[r] = 0;
+    mazeScratch.exitDir.lo[r] = mazeScratch.exitDir.hi[r] = 0;
+  }
+
+  // the exit cell itself leads out of the maze, eastwards
+  frontier[1] = visited[1] = MazeGrid::colMask(MAZE_WIDTH - 1);
+  mazeScratch.exitDir.lo.set(1, MAZE_WIDTH - 1);
+
+  bool grew = true;
+  while (grew) {
+    grew = false;
+    MazeGrid::row_t above = 0; // previous level's frontier of row r - 1
+    for (byte r = 0; r < MAZE_HEIGHT; r++) {
+      MazeGrid::row_t current = frontier[r];
+      MazeGrid::row_t below = r + 1 < MAZE_HEIGHT ? frontier[r + 1] : 0;
+      MazeGrid::row_t open = ~MAZE[r] & ~visited[r] & MazeGrid::FULL;
+
+      // column 0 is the high bit, so << 1 brings each cell's east neighbour onto it
+      MazeGrid::row_t fromEast = (MazeGrid::row_t)(current << 1) & open;
+      MazeGrid::row_t fromWest = (current >> 1) & open & ~fromEast;
+      MazeGrid::row_t fromNorth = above & open & ~(fromEast | fromWest);
+      MazeGrid::row_t fromSouth = below & open & ~(fromEast | fromWest | fromNorth);
+      MazeGrid::row_t reached = fromEast | fromWest | fromNorth | fromSouth;
+
+      mazeScratch.exitDir.lo[r] |= fromEast | fromWest;
+      mazeScratch.exitDir.hi[r] |= fromSouth | fromWest;
+      visited[r] |= reached;
+      above = current;
+      frontier[r] = reached;
+      grew |= reached != 0;
+    }
+  }
+  exitFieldValid = true;
 }
 
-bool isCarved(byte row, byte col) {
-  return !(MAZE[row] & (1 << ((MAZE_WIDTH - 1) - col)));
+Direction exitHeading(byte row, byte col) {
+  if (!exitFieldValid) solveMaze();
+  return (Direction)(mazeScratch.exitDir.hi.get(row, col) << 1 | mazeScratch.exitDir.lo.get(row, col));
 }
 
-void generateMaze() {
-  randomSeed(millis());
-  
-  // Fill with walls
-  for (int i = 0; i < MAZE_HEIGHT; i++) MAZE[i] = 0xFFFF;
-  
-  // Simple fixed start position to avoid random issues
-  startRow = 1;
-  startCol = 1;
-  
-  mazeGenStack.top = 0;  // Reset global stack
-  byte row = startRow, col = startCol;
-  carveCell(row, col);
-  mazeGenStack.push(row, col);
-  
-  int directions[][2] = {{-2,0}, {2,0}, {0,-2}, {0,2}};
-  
-  // Add safety counter to prevent infinite loops
-  int safetyCounter = 0;
+const int8_t genDirections[4][2] = {{-2,0}, {2,0}, {0,-2}, {0,2}};
+
+bool mazeGenStep(uint8_t budget) {
+  PROFILE_SCOPE(PROFILE_MAZE_GEN);
+  byte &row = mazeGen.row, &col = mazeGen.col;
+  uint8_t &order = mazeGen.directionOrder;
+
+  if (!mazeGen.started) {
+    // Fill with walls
+    MAZE.fill();
+
+    // Simple fixed start position to avoid random issues
+    startRow = 1;
+    startCol = 1;
+
+    exitFieldValid = false;
+    mazeScratch.genStack.top = 0;  // Reset global stack
+    row = startRow;
+    col = startCol;
+    carveCell(row, col);
+    mazeScratch.genStack.push(row, col);
+
+    order = 0b11100100; // 3, 2, 1, 0
+
+    // Add safety counter to prevent infinite loops
+    mazeGen.safetyCounter = 0;
+    mazeGen.started = true;
+  }
+
   const int maxIterations = MAZE_WIDTH * MAZE_HEIGHT * 4;
-  
-  while (!mazeGenStack.empty() && safetyCounter < maxIterations) {
-    safetyCounter++;
-    
+
+  for (; budget > 0; budget--) {
+    if (mazeScratch.genStack.empty() || mazeGen.safetyCounter >= maxIterations) {
+      // Create accessible exit by ensuring path connects to border
+      // First, make sure there's a path at (1, MAZE_WIDTH-2)
+      carveCell(1, MAZE_WIDTH - 2);
+
+      // Then create the exit on the border
+      MAZE.clear(1, MAZE_WIDTH - 1);  // Clear rightmost bit for exit
+
+      solveMaze();
+      mazeGen.active = false;
+      return true;
+    }
+    mazeGen.safetyCounter++;
+
     // Shuffle directions
     for (int i = 3; i > 0; i--) {
-      int j = random(i + 1);
-      int temp0 = directions[i][0], temp1 = directions[i][1];
-      directions[i][0] = directions[j][0]; directions[i][1] = directions[j][1];
-      directions[j][0] = temp0; directions[j][1] = temp1;
+      int j = rngBelow(i + 1);
+      uint8_t a = (order >> (2 * i)) & 3, b = (order >> (2 * j)) & 3;
+      order &= ~(3 << (2 * i) | 3 << (2 * j));
+      order |= b << (2 * i) | a << (2 * j);
     }
-    
+
     bool moved = false;
     for (int i = 0; i < 4; i++) {
-      byte newRow = row + directions[i][0];
-      byte newCol = col + directions[i][1];
-      
+      const int8_t *direction = genDirections[(order >> (2 * i)) & 3];
+      byte newRow = row + direction[0];
+      byte newCol = col + direction[1];
+
       if (inBounds(newRow, newCol) && !isCarved(newRow, newCol)) {
-        carveCell(row + directions[i][0]/2, col + directions[i][1]/2);
+        carveCell(row + direction[0]/2, col + direction[1]/2);
         carveCell(newRow, newCol);
-        if (!mazeGenStack.full()) {  // Only push if stack has space
-          mazeGenStack.push(row, col);
+        if (!mazeScratch.genStack.full()) {  // Only push if stack has space
+          mazeScratch.genStack.push(row, col);
         }
         row = newRow;
         col = newCol;
@@ -159,34 +341,44 @@ void generateMaze() {
         break;
       }
     }
-    
-    if (!moved) mazeGenStack.pop(row, col);
+
+    if (!moved) mazeScratch.genStack.pop(row, col);
   }
-  
-  // Create accessible exit by ensuring path connects to border
-  // First, make sure there's a path at (1, MAZE_WIDTH-2) 
-  carveCell(1, MAZE_WIDTH - 2);
-  
-  // Then create the exit on the border
-  MAZE[1] &= ~1;  // Clear rightmost bit for exit
+
+  return false;
 }
+#endif
 
-void resetMaze()
+void generateMaze() {
+  mazeGenBegin();
+  while (!mazeGenStep(0xFF));
+}
+
+void placePlayer()
 {
-  generateMaze();
   playerCol = startCol;
   playerRow = startRow;
   playerHeading = EAST;
 }
 
-bool isWall(byte row, byte col)
+// spread across calls: true once the new maze is ready and the player is at the start
+bool stepMazeReset(uint8_t budget)
 {
-  if (row < 0 || row >= MAZE_HEIGHT || col < 0 || col >= MAZE_WIDTH)
+  if (!mazeGenStep(budget))
     return false;
-  else
-  {
-    return bitRead(MAZE[row], (MAZE_WIDTH - 1) - col);
-  }
+  placePlayer();
+  return true;
+}
+
+void resetMaze()
+{
+  generateMaze();
+  placePlayer();
+}
+
+bool isWall(byte row, byte col)
+{
+  return MAZE.test(row, col);
 }
 
 bool isExitPosition(byte row, byte col)
@@ -195,46 +387,51 @@ bool isExitPosition(byte row, byte col)
   return (row <= 0 || row >= (MAZE_HEIGHT - 1) || col <= 0 || col >= (MAZE_WIDTH - 1));
 }
 
+// look*() read the two cell rows ahead in one neighborhood fetch instead of six isWall() calls
 void lookNorth(byte row, byte col)
 {
-  hasFrontLeftWall = isWall(row, col - 1);
-  hasFrontWall     = isWall(row, col);
-  hasFrontRightWall = isWall(row, col + 1);
-  hasBackLeftWall  = isWall(row - 1, col - 1);
-  hasBackWall      = isWall(row - 1, col);
-  hasBackRightWall = isWall(row - 1, col + 1);
-  hasExit          = !hasFrontWall && isExitPosition(row, col);
+  uint16_t n = MAZE.neighborhood(row, col);
+  walls.frontLeft  = n & NEIGHBOR_BIT(0, -1);
+  walls.front      = n & NEIGHBOR_BIT(0, 0);
+  walls.frontRight = n & NEIGHBOR_BIT(0, 1);
+  walls.backLeft   = n & NEIGHBOR_BIT(-1, -1);
+  walls.back       = n & NEIGHBOR_BIT(-1, 0);
+  walls.backRight  = n & NEIGHBOR_BIT(-1, 1);
+  walls.exit       = !walls.front && isExitPosition(row, col);
 }
 
 void lookEast(byte row, byte col)
 {
-  hasFrontLeftWall = isWall(row - 1, col);
-  hasFrontWall     = isWall(row, col);
-  hasFrontRightWall = isWall(row + 1, col);
-  hasBackLeftWall  = isWall(row - 1, col + 1);
-  hasBackWall      = isWall(row,  col + 1);
-  hasBackRightWall = isWall(row + 1, col + 1);
-  hasExit          = !hasFrontWall && isExitPosition(row, col);
+  uint16_t n = MAZE.neighborhood(row, col);
+  walls.frontLeft  = n & NEIGHBOR_BIT(-1, 0);
+  walls.front      = n & NEIGHBOR_BIT(0, 0);
+  walls.frontRight = n & NEIGHBOR_BIT(1, 0);
+  walls.backLeft   = n & NEIGHBOR_BIT(-1, 1);
+  walls.back       = n & NEIGHBOR_BIT(0, 1);
+  walls.backRight  = n & NEIGHBOR_BIT(1, 1);
+  walls.exit       = !walls.front && isExitPosition(row, col);
 }
 
 void lookSouth(byte row, byte col)
 {
-  hasFrontLeftWall = isWall(row, col + 1);
-  hasFrontWall     = isWall(row, col);
-  hasFrontRightWall = isWall(row, col - 1);
-  hasBackLeftWall  = isWall(row + 1, col + 1);
-  hasBackWall      = isWall(row + 1, col);
-  hasBackRightWall = isWall(row + 1, col - 1);
-  hasExit          = !hasFrontWall && isExitPosition(row, col);
+  uint16_t n = MAZE.neighborhood(row, col);
+  walls.frontLeft  = n & NEIGHBOR_BIT(0, 1);
+  walls.front      = n & NEIGHBOR_BIT(0, 0);
+  walls.frontRight = n & NEIGHBOR_BIT(0, -1);
+  walls.backLeft   = n & NEIGHBOR_BIT(1, 1);
+  walls.back       = n & NEIGHBOR_BIT(1, 0);
+  walls.backRight  = n & NEIGHBOR_BIT(1, -1);
+  walls.exit       = !walls.front && isExitPosition(row, col);
 }
 
 void lookWest(byte row, byte col)
 {
-  hasFrontLeftWall = isWall(row + 1, col);
-  hasFrontWall     = isWall(row,     col);
-  hasFrontRightWall = isWall(row - 1, col);
-  hasBackLeftWall  = isWall(row + 1, col - 1);
-  hasBackWall      = isWall(row,     col - 1);
-  hasBackRightWall = isWall(row - 1, col - 1);
-  hasExit          = !hasFrontWall && isExitPosition(row, col);
+  uint16_t n = MAZE.neighborhood(row, col);
+  walls.frontLeft  = n & NEIGHBOR_BIT(1, 0);
+  walls.front      = n & NEIGHBOR_BIT(0, 0);
+  walls.frontRight = n & NEIGHBOR_BIT(-1, 0);
+  walls.backLeft   = n & NEIGHBOR_BIT(1, -1);
+  walls.back       = n & NEIGHBOR_BIT(0, -1);
+  walls.backRight  = n & NEIGHBOR_BIT(-1, -1);
+  walls.exit       = !walls.front && isExitPosition(row, col);
 }
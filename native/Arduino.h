@@ -0,0 +1,76 @@
+#pragma once
+
+// Host stand-in for the Arduino core, used by env:native only. Covers just the
+// subset of the API the sketch touches; time is virtual and only advances via
+// delay() or by writing nativeMillis directly.
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef uint8_t byte;
+
+#ifndef F_CPU
+#define F_CPU 20000000UL // board_build.f_cpu of env:default
+#endif
+
+#define HIGH 0x1
+#define LOW 0x0
+#define INPUT 0x0
+#define OUTPUT 0x1
+
+#define PROGMEM
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define pgm_read_word(addr) (*(const uint16_t *)(addr))
+
+#define bit(b) (1UL << (b))
+#define bitRead(value, bit) (((value) >> (bit)) & 0x01)
+
+#ifndef max
+#define max(a, b) ((a) > (b) ? (a) : (b))
+#endif
+#ifndef min
+#define min(a, b) ((a) < (b) ? (a) : (b))
+#endif
+
+#define ISR(vector) void vector(void)
+#define cli()
+#define sei()
+
+// pins
+inline uint8_t nativePinState[32];
+
+inline void pinMode(uint8_t, uint8_t) {}
+
+inline void digitalWrite(uint8_t pin, uint8_t val)
+{
+  nativePinState[pin & 31] = val;
+}
+
+// time
+inline unsigned long nativeMillis = 0;
+
+inline unsigned long millis() { return nativeMillis; }
+inline unsigned long micros() { return nativeMillis * 1000; }
+inline void delayMicroseconds(unsigned int) {} // busy waits take no virtual time
+inline void delay(unsigned long ms) { nativeMillis += ms; }
+
+// random, same contract as the AVR core: random(max) returns [0, max)
+inline uint32_t nativeRandomState = 1;
+
+inline void randomSeed(unsigned long seed)
+{
+  if (seed != 0)
+    nativeRandomState = seed;
+}
+
+inline long random(long howbig)
+{
+  if (howbig == 0)
+    return 0;
+  nativeRandomState = nativeRandomState * 1103515245u + 12345u;
+  return (nativeRandomState >> 16) % howbig;
+}
+
+// peripheral registers
+#include "avr/io.h"
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Host stand-in for the megaAVR SPI library. Transfers complete immediately;
+// the last words shifted out are kept so callers can inspect them.
+
+class SPIClass
+{
+public:
+  void begin() {}
+  void end() {}
+
+  uint8_t transfer(uint8_t data)
+  {
+    lastTransfer[1] = lastTransfer[0];
+    lastTransfer[0] = data;
+    transferCount++;
+    return 0;
+  }
+
+  uint16_t transfer16(uint16_t data)
+  {
+    lastTransfer[1] = lastTransfer[0];
+    lastTransfer[0] = data;
+    transferCount++;
+    return 0;
+  }
+
+  uint16_t lastTransfer[2] = {0, 0}; // [0] = most recent
+  unsigned long transferCount = 0;
+};
+
+inline SPIClass SPI;
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Host stand-in for the TwoWire slave API. nativeReceive() plays the part of
+// the bus master: it queues bytes and invokes the registered onReceive handler.
+
+#define NATIVE_WIRE_BUFFER_SIZE 32
+
+class TwoWire
+{
+public:
+  void begin(uint8_t address) { this->address = address; }
+  void onReceive(void (*handler)(int)) { receiveHandler = handler; }
+  void onRequest(void (*handler)(void)) { requestHandler = handler; }
+
+  int available() { return rxLength - rxIndex; }
+  int read() { return rxIndex < rxLength ? rxBuffer[rxIndex++] : -1; }
+  int peek() { return rxIndex < rxLength ? rxBuffer[rxIndex] : -1; }
+
+  size_t write(uint8_t data)
+  {
+    if (txLength >= NATIVE_WIRE_BUFFER_SIZE)
+      return 0;
+    txBuffer[txLength++] = data;
+    return 1;
+  }
+
+  size_t write(const uint8_t *data, size_t length)
+  {
+    size_t written = 0;
+    while (written < length && write(data[written]))
+      written++;
+    return written;
+  }
+
+  void nativeReceive(const uint8_t *data, uint8_t length)
+  {
+    if (length > NATIVE_WIRE_BUFFER_SIZE)
+      length = NATIVE_WIRE_BUFFER_SIZE;
+    memcpy(rxBuffer, data, length);
+    rxLength = length;
+    rxIndex = 0;
+    if (receiveHandler)
+      receiveHandler(length);
+  }
+
+  uint8_t nativeRequest()
+  {
+    txLength = 0;
+    if (requestHandler)
+      requestHandler();
+    return txLength;
+  }
+
+  uint8_t address = 0;
+  uint8_t rxBuffer[NATIVE_WIRE_BUFFER_SIZE];
+  uint8_t rxLength = 0;
+  uint8_t rxIndex = 0;
+  uint8_t txBuffer[NATIVE_WIRE_BUFFER_SIZE];
+  uint8_t txLength = 0;
+  void (*receiveHandler)(int) = nullptr;
+  void (*requestHandler)(void) = nullptr;
+};
+
+inline TwoWire Wire;
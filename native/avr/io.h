@@ -0,0 +1,73 @@
+#pragma once
+
+// Host stand-in for the ATtiny817 peripheral registers the sketch writes. The
+// registers are plain memory so writes are harmless and reads see the last value.
+
+#include <stdint.h>
+
+typedef struct TCB_struct
+{
+  volatile uint8_t CTRLA;
+  volatile uint8_t CTRLB;
+  volatile uint8_t EVCTRL;
+  volatile uint8_t INTCTRL;
+  volatile uint8_t INTFLAGS;
+  volatile uint8_t STATUS;
+  volatile uint8_t DBGCTRL;
+  volatile uint8_t TEMP;
+  volatile uint16_t CNT;
+  volatile uint16_t CCMP;
+} TCB_t;
+
+inline TCB_t TCB0;
+
+#define TCB_ENABLE_bm 0x01
+#define TCB_CLKSEL_CLKDIV1_gc (0x00 << 1)
+#define TCB_CLKSEL_CLKDIV2_gc (0x01 << 1)
+#define TCB_CLKSEL_CLKTCA_gc (0x02 << 1)
+#define TCB_CNTMODE_INT_gc (0x00 << 0)
+#define TCB_CAPT_bm 0x01
+
+inline volatile uint8_t SREG;
+
+typedef struct VPORT_struct
+{
+  volatile uint8_t DIR;
+  volatile uint8_t OUT;
+  volatile uint8_t IN;
+  volatile uint8_t INTFLAGS;
+} VPORT_t;
+
+inline VPORT_t VPORTA, VPORTB, VPORTC;
+
+#define PIN0_bm 0x01
+#define PIN1_bm 0x02
+#define PIN2_bm 0x04
+#define PIN3_bm 0x08
+#define PIN4_bm 0x10
+#define PIN5_bm 0x20
+#define PIN6_bm 0x40
+#define PIN7_bm 0x80
+
+typedef struct SPI_struct
+{
+  volatile uint8_t CTRLA;
+  volatile uint8_t CTRLB;
+  volatile uint8_t INTCTRL;
+  volatile uint8_t INTFLAGS;
+  volatile uint8_t DATA;
+} SPI_t;
+
+inline SPI_t SPI0;
+
+#define SPI_ENABLE_bm 0x01
+#define SPI_MASTER_bm 0x20
+#define SPI_BUFEN_bm 0x80
+#define SPI_BUFWR_bm 0x40
+#define SPI_SSD_bm 0x04
+#define SPI_RXCIE_bm 0x80
+#define SPI_TXCIE_bm 0x40
+#define SPI_DREIE_bm 0x20
+#define SPI_RXCIF_bm 0x80
+#define SPI_TXCIF_bm 0x40
+#define SPI_DREIF_bm 0x20
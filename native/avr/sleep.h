@@ -0,0 +1,10 @@
+#pragma once
+
+// Host stand-in for avr-libc sleep control; sleeping is a no-op since nothing else runs.
+
+#define SLEEP_MODE_IDLE 0
+
+inline void set_sleep_mode(uint8_t) {}
+inline void sleep_enable() {}
+inline void sleep_disable() {}
+inline void sleep_cpu() {}
@@ -1,23 +1,81 @@
 
 #include "maze.h"
 
-#define DEFAULT_ANIMATION_DELAY 100  // Slower animation for visibility
+#define ANIMATION_FRAME_INTERVAL 16       // ms between animation updates, ~60 fps
+#define WALK_DURATION (H_INSET * 100)     // ms to walk into the next cell
+#define TURN_DURATION (SCREEN_WIDTH * 25) // ms for a quarter turn
 
-int playerRow, playerCol;
+enum NavigationMode : uint8_t {
+  NAV_SHORTEST_PATH, // follow exitHeading() straight to the exit
+  NAV_EXPLORE        // right-hand rule, wanders most of the maze
+};
+
+int8_t playerRow, playerCol;
 Direction playerHeading = NORTH;
 Rotation playerRotation = NO_ROT;
 Direction playerMoveDirection = NO_DIR;
 bool justTurned = false;
+bool playerExited = false; // walked out of the exit, waiting for the owner to reset the maze
+// -DNAVIGATION_EXPLORE boots into the right-hand rule, CMD_SET_NAVIGATION switches at runtime
+#if defined(MAZE_ENDLESS) || defined(NAVIGATION_EXPLORE)
+NavigationMode navigationMode = NAV_EXPLORE; // endless mazes have no exit to head for
+#else
+NavigationMode navigationMode = NAV_SHORTEST_PATH;
+#endif
 
 unsigned long playerLastMoved = 0;
 uint16_t playerMoveDelay = 500;  // Longer pause between moves
 
-unsigned long timeToMove;
-uint16_t zoom = 0;
-uint16_t zoomDir = 0;
-uint16_t zoomSpeed = 1;
-uint16_t hShift = 0;
-uint16_t turnSpeed = 4;
+// Walks and turns are timed animations: the position is an 8.8 fixed-point fraction of the
+// distance, eased by elapsed time and rounded down to the whole pixels the renderer draws
+unsigned long timeToMove;   // next animation update
+unsigned long animStart;
+uint16_t animDuration;      // ms
+uint16_t animRate;          // progress per ms, 256 = whole animation, in 8.8
+uint8_t animDistance;       // pixels
+uint16_t animPosition = 0;  // 8.8 pixels
+uint8_t zoom = 0;           // whole-pixel walk offset drawn by the renderer
+uint8_t hShift = 0;         // columns the turn has slid so far, 0..CLIP_WIDTH
+
+// smoothstep 3t^2 - 2t^3 sampled at EASE_STEPS + 1 points, output 0..256
+#define EASE_STEPS 16
+
+struct EaseTable
+{
+  uint16_t values[EASE_STEPS + 1];
+};
+
+constexpr EaseTable makeEaseTable()
+{
+  EaseTable table = {};
+  for (uint32_t i = 0; i <= EASE_STEPS; i++)
+    table.values[i] = (3 * i * i * EASE_STEPS - 2 * i * i * i) * 256 / (EASE_STEPS * EASE_STEPS * EASE_STEPS);
+  return table;
+}
+
+const EaseTable easeTable PROGMEM = makeEaseTable();
+
+// eased progress for linear progress t, both 0..256, interpolated between table entries
+uint16_t ease(uint16_t t)
+{
+  uint8_t index = t / (256 / EASE_STEPS);
+  if (index >= EASE_STEPS)
+    return 256;
+  uint8_t frac = t % (256 / EASE_STEPS);
+  uint16_t a = pgm_read_word(&easeTable.values[index]);
+  uint16_t b = pgm_read_word(&easeTable.values[index + 1]);
+  return a + (uint16_t)((b - a) * frac) / (256 / EASE_STEPS);
+}
+
+void startAnimation(uint16_t duration, uint8_t distance)
+{
+  animStart = millis();
+  animDuration = duration;
+  animRate = 65536UL / duration; // the only division, later updates multiply
+  animDistance = distance;
+  animPosition = 0;
+  timeToMove = animStart - 1; // first update on the next tick
+}
 
 bool atExit() {
   return (playerRow == 0 || playerRow == (MAZE_HEIGHT - 1) || playerCol == 0 || playerCol == (MAZE_WIDTH - 1));
@@ -39,93 +97,156 @@ bool canMoveInDirection(Direction dir)
   }
 }
 
-bool move()
+void startMove()
+{
+  playerMoveDirection = playerHeading;
+  zoom = 0;
+  justTurned = false;
+  // walking out of the exit zooms on through the opening, twice as far
+  uint8_t distance = atExit() ? H_INSET * 2 : H_INSET;
+  startAnimation(WALK_DURATION * (distance / H_INSET), distance);
+}
+
+void startTurn(Rotation rotation)
+{
+  playerRotation = rotation;
+  justTurned = true;
+  hShift = 0;
+  turnViewValid = false; // even back-to-back turns with no straight frame between get fresh views
+  startAnimation(TURN_DURATION, CLIP_WIDTH); // one column of slide per visible pixel
+}
+
+// navigate through maze always going right at turns when possible, then straight forward, then left at corners
+void exploreStep()
+{
+  if (!justTurned && canMoveInDirection(turnRight(playerHeading)))
+    startTurn(RIGHT);
+  else if (canMoveInDirection(playerHeading))
+    startMove();
+  else if (canMoveInDirection(turnLeft(playerHeading)))
+    startTurn(LEFT);
+  else
+    startTurn(RIGHT);
+}
+
+void shortestPathStep()
+{
+#if defined(MAZE_ENDLESS)
+  exploreStep();
+#else
+  Direction target = exitHeading(playerRow, playerCol);
+  if (!canMoveInDirection(target))
+    exploreStep(); // cell the search never reached, shouldn't happen in a perfect maze
+  else if (target == playerHeading)
+    startMove();
+  else if (target == turnLeft(playerHeading))
+    startTurn(LEFT);
+  else
+    startTurn(RIGHT);
+#endif
+}
+
+// drop any walk or turn in progress, e.g. before the maze is replaced underneath the player
+void stopPlayer()
+{
+  playerMoveDirection = NO_DIR;
+  playerRotation = NO_ROT;
+  zoom = 0;
+  hShift = 0;
+}
+
+bool playerIdle()
 {
+  return playerMoveDirection == NO_DIR && playerRotation == NO_ROT;
+}
+
+// auto-movement decision, returns true when a new move or turn started
+bool updatePlayer()
+{
+  PROFILE_SCOPE(PROFILE_UPDATE_PLAYER);
   bool needsRedraw = false;
 
-  // Auto-movement decision using modified right-hand rule (only when idle)
-  if (playerMoveDirection == NO_DIR && playerRotation == NO_ROT)
+  if (playerIdle())
   {
-    if (millis() > playerLastMoved)
+    if ((long)(millis() - playerLastMoved) > 0)
     {
-      // navigate through maze always going right at turns when possible, then straight forward, then left at corners 
-      if (!justTurned && canMoveInDirection(turnRight(playerHeading))) {
-        playerRotation = RIGHT;
-        justTurned = true;
-        needsRedraw = true;
-      }
-      else if (canMoveInDirection(playerHeading)) {
-        playerMoveDirection = playerHeading;
-        zoom = 0;
-        zoomDir = +zoomSpeed;
-        justTurned = false;
-        needsRedraw = true;
-      }
-      else if (canMoveInDirection(turnLeft(playerHeading))) {
-        playerRotation = LEFT;
-        justTurned = true;
-        needsRedraw = true;
-      }
-      else {
-        playerRotation = RIGHT;
-        justTurned = true;
-        needsRedraw = true;
-      }
+      if (navigationMode == NAV_SHORTEST_PATH)
+        shortestPathStep();
+      else
+        exploreStep();
+      needsRedraw = true;
       playerLastMoved = millis() + playerMoveDelay;
     }
   }
 
-  // Animation updates
-  if (millis() > timeToMove) {
-    // Turning animation
-    if (playerRotation != NO_ROT)
-    {
-      hShift += turnSpeed;
-      if ((hShift <= 0) || (hShift >= SCREEN_WIDTH))
-      {
-        hShift = 0;
-        playerHeading = (playerRotation == RIGHT) ? turnRight(playerHeading) : turnLeft(playerHeading);
-        playerRotation = NO_ROT;
-      }
-
-      timeToMove = millis() + DEFAULT_ANIMATION_DELAY;
-      needsRedraw = true;
-    }
-    // Walking animation
-    else if (zoomDir != 0)
-    {
-      zoom += zoomDir;
-
-      if (atExit())
-      {
-        if (zoom >= H_INSET * 2) {
-          zoom = 0;
-          zoomDir = 0;
-          playerMoveDirection = NO_DIR;
-
-          delay(1000);
-          resetMaze();
-          return true;  // Reset maze if at exit
-        }
-      }
-      else if (zoom >= H_INSET)
-      {
-        zoom = 0;
-        zoomDir = 0;
-        switch (playerMoveDirection) {
-          case NORTH: playerRow--; break;
-          case EAST:  playerCol++; break;
-          case SOUTH: playerRow++; break;
-          case WEST:  playerCol--; break;
-          case NO_DIR: break;
-        }
-        playerMoveDirection = NO_DIR;
-      }
-      
-      timeToMove = millis() + DEFAULT_ANIMATION_DELAY;
-      needsRedraw = true;
-    }
+  return needsRedraw;
+}
+
+// advances the turn/walk animation, returns true when the view changed
+bool updateAnimation()
+{
+  PROFILE_SCOPE(PROFILE_UPDATE_ANIMATION);
+
+  if (playerIdle() || (long)(millis() - timeToMove) <= 0)
+    return false;
+  timeToMove = millis() + ANIMATION_FRAME_INTERVAL;
+
+  unsigned long elapsed = millis() - animStart;
+  if (elapsed < animDuration)
+  {
+    uint16_t progress = (uint32_t)elapsed * animRate >> 8;
+    animPosition = ease(progress) * animDistance;
+    uint8_t pixels = animPosition >> 8;
+    uint8_t &offset = playerRotation != NO_ROT ? hShift : zoom;
+    if (pixels == offset)
+      return false; // still within the same pixel, nothing new to draw
+    offset = pixels;
+    return true;
+  }
+
+  // Turning animation
+  if (playerRotation != NO_ROT)
+  {
+    hShift = 0;
+    playerHeading = (playerRotation == RIGHT) ? turnRight(playerHeading) : turnLeft(playerHeading);
+    playerRotation = NO_ROT;
+    return true;
+  }
+
+  // Walking animation
+  zoom = 0;
+  if (atExit())
+  {
+    playerMoveDirection = NO_DIR;
+    playerExited = true;
+    return false;  // maze gets reset, nothing new to draw
   }
 
+  switch (playerMoveDirection) {
+    case NORTH: playerRow--; break;
+    case EAST:  playerCol++; break;
+    case SOUTH: playerRow++; break;
+    case WEST:  playerCol--; break;
+    case NO_DIR: break;
+  }
+  playerMoveDirection = NO_DIR;
+#if defined(MAZE_ENDLESS)
+  if (playerRow > MAZE_HEIGHT / 2)
+    scrollMaze();
+#endif
+  return true;
+}
+
+// blocking variant of the scheduler tasks, resets in place when the exit is reached
+bool move()
+{
+  bool needsRedraw = updatePlayer();
+  needsRedraw |= updateAnimation();
+  if (playerExited)
+  {
+    playerExited = false;
+    resetMaze();
+    needsRedraw = true;
+  }
   return needsRedraw;
 }
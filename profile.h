@@ -0,0 +1,256 @@
+#pragma once
+
+#include <Arduino.h>
+#include <stdio.h>
+
+// -DPROFILE times scoped hot-path regions and keeps min/max/mean and a log2 histogram per region.
+// On the chip timestamps are CPU cycles from TCA0, free running at CLK_PER and extended to 32 bits
+// by its overflow interrupt (every 3.3 ms at 20 MHz), so TCA0 PWM is unavailable in profiling
+// builds and the millis timer must not be TCA0 (the 1-series default is TCD0). Reports are written
+// straight to USART0 (TXD on PB2) at PROFILE_BAUD, without HardwareSerial and its ring buffers;
+// the host build uses CLOCK_MONOTONIC nanoseconds and prints to stdout.
+//
+// Each recorded region takes an 18-byte stats slot, which the ATtiny817 can't spare for all of
+// them, so -DPROFILE_REGIONS=mask (bit n for ProfileRegion n) picks the regions of a build and the
+// scopes of the others compile to nothing. The chip defaults to the ISR that streams rows, the
+// host to all regions.
+//
+// Overhead per scope is two timestamp reads plus the record, roughly 150 cycles on the chip. The
+// back-to-back cost of the two reads is measured in profileInit() and subtracted, so figures are
+// close to the region itself; the record itself still shows up in enclosing regions.
+// Without -DPROFILE every macro below expands to nothing.
+
+enum ProfileRegion
+{
+  PROFILE_SCAN_ISR,
+  PROFILE_SPI_ISR,
+  PROFILE_DRAW_MAZE,
+  PROFILE_DRAW_WALLS,
+  PROFILE_MAZE_GEN,
+  PROFILE_UPDATE_PLAYER,
+  PROFILE_UPDATE_ANIMATION,
+  NUM_PROFILE_REGIONS
+};
+
+#if defined(PROFILE)
+
+#ifndef PROFILE_BAUD
+#define PROFILE_BAUD 115200
+#endif
+#ifndef PROFILE_REGIONS
+#if !defined(__AVR__)
+#define PROFILE_REGIONS (bit(NUM_PROFILE_REGIONS) - 1)
+#elif defined(SCAN_SPI_ASYNC)
+#define PROFILE_REGIONS bit(PROFILE_SPI_ISR)
+#else
+#define PROFILE_REGIONS bit(PROFILE_SCAN_ISR)
+#endif
+#endif
+#define PROFILE_BUCKETS 4
+#define PROFILE_BUCKET_SHIFT 7 // bucket 0 is below 128 units, each next one doubles, the last is open
+
+#if !defined(__AVR__)
+#include <time.h>
+#define PROFILE_UNIT "ns"
+#else
+#define PROFILE_UNIT "cyc"
+#endif
+
+const char *const profileNames[NUM_PROFILE_REGIONS] = {
+    "TCB0_INT_vect",
+    "SPI0_INT_vect",
+    "drawMaze",
+    "drawWalls",
+    "mazeGenStep",
+    "updatePlayer",
+    "updateAnimation",
+};
+
+// all cleared by each report, so they only have to hold one report interval
+struct ProfileStats
+{
+  uint16_t count; // stops at 0xFFFF, later runs in the interval aren't recorded
+  uint16_t min;   // min, max and buckets saturate at 0xFFFF units, 3.3 ms on the chip
+  uint16_t max;
+  uint32_t total;
+  uint16_t buckets[PROFILE_BUCKETS];
+};
+
+constexpr bool profileSelected(uint8_t region)
+{
+  return (PROFILE_REGIONS >> region) & 1;
+}
+
+// stats slot of a selected region: the selected regions below it
+constexpr uint8_t profileSlot(uint8_t region)
+{
+  return region == 0 ? 0 : profileSlot(region - 1) + profileSelected(region - 1);
+}
+
+#define NUM_PROFILE_SLOTS profileSlot(NUM_PROFILE_REGIONS)
+static_assert(NUM_PROFILE_SLOTS > 0, "PROFILE_REGIONS selects no region");
+
+ProfileStats profileStats[NUM_PROFILE_SLOTS];
+uint16_t profileOverhead = 0;
+
+#if defined(__AVR__)
+volatile uint16_t profileOverflows = 0;
+
+ISR(TCA0_OVF_vect)
+{
+  TCA0.SINGLE.INTFLAGS = TCA_SINGLE_OVF_bm;
+  profileOverflows++;
+}
+
+inline uint32_t profileNow()
+{
+  uint8_t oldSREG = SREG;
+  cli();
+  uint16_t count = TCA0.SINGLE.CNT;
+  uint16_t overflows = profileOverflows;
+  // an overflow that hasn't been serviced yet belongs to a count that already wrapped
+  if ((TCA0.SINGLE.INTFLAGS & TCA_SINGLE_OVF_bm) && count < 0x8000)
+    overflows++;
+  SREG = oldSREG;
+  return (uint32_t)overflows << 16 | count;
+}
+#else
+inline uint32_t profileNow()
+{
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint32_t)now.tv_sec * 1000000000u + now.tv_nsec; // wraps every 4.3 s, differences stay valid
+}
+#endif
+
+void profileClear()
+{
+  uint8_t oldSREG = SREG;
+  cli();
+  for (uint8_t i = 0; i < NUM_PROFILE_SLOTS; i++)
+  {
+    memset(&profileStats[i], 0, sizeof(ProfileStats));
+    profileStats[i].min = 0xFFFF;
+  }
+  SREG = oldSREG;
+}
+
+void profileRecord(uint8_t slot, uint32_t elapsed)
+{
+  ProfileStats &stats = profileStats[slot];
+  if (stats.count == 0xFFFF)
+    return;
+
+  elapsed = elapsed > profileOverhead ? elapsed - profileOverhead : 0;
+  uint16_t units = elapsed > 0xFFFF ? 0xFFFF : elapsed;
+  stats.count++;
+  stats.total += elapsed;
+  if (units < stats.min)
+    stats.min = units;
+  if (units > stats.max)
+    stats.max = units;
+
+  uint8_t bucket = 0;
+  for (uint16_t rest = units >> PROFILE_BUCKET_SHIFT; rest && bucket < PROFILE_BUCKETS - 1; rest >>= 1)
+    bucket++;
+  stats.buckets[bucket]++; // can't pass count
+}
+
+// times the enclosing block, early returns included; empty for regions PROFILE_REGIONS leaves out
+template <uint8_t Region, bool Selected = profileSelected(Region)>
+struct ProfileScope
+{
+  uint32_t start;
+
+  ProfileScope() : start(profileNow()) {}
+  ~ProfileScope() { profileRecord(profileSlot(Region), profileNow() - start); }
+};
+
+template <uint8_t Region>
+struct ProfileScope<Region, false>
+{
+  ProfileScope() {}
+};
+
+void profileInit()
+{
+#if defined(__AVR__)
+  takeOverTCA0();
+  TCA0.SINGLE.PER = 0xFFFF;
+  TCA0.SINGLE.INTCTRL = TCA_SINGLE_OVF_bm;
+  TCA0.SINGLE.CTRLA = TCA_SINGLE_CLKSEL_DIV1_gc | TCA_SINGLE_ENABLE_bm;
+
+  PORTB.DIRSET = PIN2_bm; // TXD
+  USART0.BAUD = (4 * F_CPU + PROFILE_BAUD / 2) / PROFILE_BAUD;
+  USART0.CTRLB = USART_TXEN_bm;
+#endif
+
+  // smallest of a few back-to-back reads, so a stray interrupt doesn't inflate it
+  profileOverhead = 0xFFFF;
+  for (uint8_t i = 0; i < 8; i++)
+  {
+    uint32_t start = profileNow();
+    uint32_t elapsed = profileNow() - start;
+    if (elapsed < profileOverhead)
+      profileOverhead = elapsed;
+  }
+  profileClear();
+}
+
+// blocking, a report every few seconds doesn't need a transmit buffer
+void profileWrite(const char *line)
+{
+#if defined(__AVR__)
+  for (; *line; line++)
+  {
+    while (!(USART0.STATUS & USART_DREIF_bm))
+      ;
+    USART0.TXDATAL = *line;
+  }
+#else
+  fputs(line, stdout);
+#endif
+}
+
+// one line per region that ran since the last report, then start a new interval
+void profileReport()
+{
+  char line[96];
+  for (uint8_t i = 0; i < NUM_PROFILE_REGIONS; i++)
+  {
+    if (!profileSelected(i))
+      continue;
+    uint8_t oldSREG = SREG;
+    cli();
+    ProfileStats stats = profileStats[profileSlot(i)];
+    SREG = oldSREG;
+    if (stats.count == 0)
+      continue;
+
+    snprintf(line, sizeof(line), "%-16s n=%lu min=%lu mean=%lu max=%lu " PROFILE_UNIT " |",
+             profileNames[i], (unsigned long)stats.count, (unsigned long)stats.min,
+             (unsigned long)(stats.total / stats.count), (unsigned long)stats.max);
+    profileWrite(line);
+    for (uint8_t bucket = 0; bucket < PROFILE_BUCKETS; bucket++)
+    {
+      snprintf(line, sizeof(line), " %u", stats.buckets[bucket]);
+      profileWrite(line);
+    }
+    profileWrite("\n");
+  }
+  profileClear();
+}
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(region) ProfileScope<region> PROFILE_CONCAT(profileScope, __LINE__)
+#define PROFILE_INIT() profileInit()
+#define PROFILE_REPORT() profileReport()
+
+#else
+
+#define PROFILE_SCOPE(region)
+#define PROFILE_INIT()
+#define PROFILE_REPORT()
+
+#endif
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Marsaglia xorshift32 for maze generation: three shifts and xors per draw, no multiply or
+// division, and reseedable so a maze can be regenerated from its seed. rngBelow() takes only
+// the bits it needs from a pool refilled 32 at a time and rejects values past the bound, so it
+// stays unbiased without a modulo and most maze draws cost a shift and a mask.
+
+// -DMAZE_SEED=n generates every maze from the same seed, 0 picks a fresh one per maze
+#ifndef MAZE_SEED
+#define MAZE_SEED 0
+#endif
+
+uint32_t rngState = 1;
+uint32_t rngPool = 0;  // unused output bits of the last draw
+uint8_t rngPoolBits = 0;
+volatile uint32_t rngSeedOverride = MAZE_SEED; // also set over I2C
+uint32_t mazeSeed = 0;                         // seed of the current maze, for replay
+
+void rngSeed(uint32_t seed)
+{
+  rngState = seed ? seed : 0x2545F491; // an all-zero state would stay zero
+  rngPoolBits = 0;
+}
+
+// seed for the next maze: the override if set, otherwise the clock mixed with the scan phase
+uint32_t rngNextSeed()
+{
+  // I2C writes the override from its ISR, so take all four bytes at once
+  uint8_t oldSREG = SREG;
+  cli();
+  uint32_t seed = rngSeedOverride;
+  SREG = oldSREG;
+  if (seed)
+    return seed;
+  seed = millis() ^ ((uint32_t)TCB0.CNT << 16);
+  return seed ? seed : 1;
+}
+
+uint32_t rngNext()
+{
+  uint32_t x = rngState;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  return rngState = x;
+}
+
+// `count` random bits, 0..8
+uint8_t rngBits(uint8_t count)
+{
+  if (rngPoolBits < count)
+  {
+    rngPool = rngNext();
+    rngPoolBits = 32;
+  }
+  uint8_t value = rngPool & ((1 << count) - 1);
+  rngPool >>= count;
+  rngPoolBits -= count;
+  return value;
+}
+
+// uniform in [0, bound), bound 1..255
+uint8_t rngBelow(uint8_t bound)
+{
+  uint8_t bits = 0;
+  while ((uint8_t)(bound - 1) >> bits)
+    bits++;
+
+  uint8_t value;
+  do
+    value = rngBits(bits);
+  while (value >= bound); // fewer than two tries on average
+  return value;
+}
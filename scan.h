@@ -3,56 +3,361 @@
 #include <Arduino.h>
 #include <SPI.h>
 
+#include "bitgrid.h"
+#include "profile.h"
+
 // Pin definitions
 #define LATCH_PIN 16 // RCLK/STB
 #define OE_PIN 17    // !OE, can be tied to GND if need to save pin
 // #define DATA_PIN 18   // MOSI/IN
 // #define CLOCK_PIN 20  // SCLK/CLK
 
-// Matrix size and type configuration based on build flags
+// direct port access for latch/OE (pins 16/17 are PC4/PC5), single-cycle SBI/CBI in the ISR
+#define SCAN_VPORT VPORTC
+#define LATCH_bm PIN4_bm
+#define OE_bm PIN5_bm
+
+// -DSCAN_SPI_ASYNC streams each row from the SPI interrupt in buffered mode and latches on
+// transfer complete, instead of busy-waiting on SPI.transfer() inside TCB0_INT_vect. Experimental:
+// the cycle saving is an estimate until env:profile_async (TCB0_INT_vect plus SPI0_INT_vect) has
+// been measured against env:profile on the chip
+
+// Panel size from build flags, -DMATRIX_PANELS=n daisy-chains n of them left to right on the same
+// SPI, latch and OE lines, e.g. two or three 16x16 panels for a 32x16 or 48x16 wall; their frame
+// pool doesn't fit the ATtiny817, see SCAN_FRAME_BUDGET
 #if defined(MATRIX_16X16)
 #define NUM_ROWS 16
 #define NUM_COLS 16
-#define NUM_LEDS 256
-#define NUM_BLANK_CYCLES 0
-#define BLANK_DATA 0xFFFF
-typedef uint16_t rowdata_t;
 #elif defined(MATRIX_8X8)
 #define NUM_ROWS 8
 #define NUM_COLS 8
-#define NUM_LEDS 64
-#define NUM_BLANK_CYCLES 2
-#define BLANK_DATA 0xFF
-typedef uint8_t rowdata_t;
 #else
 #error "No matrix size defined. Use -DMATRIX_8X8 or -DMATRIX_16X16"
 #endif
 
+#ifndef MATRIX_PANELS
+#define MATRIX_PANELS 1
+#endif
+
 #define MATRIX_HEIGHT NUM_ROWS
-#define MATRIX_WIDTH NUM_COLS
+#define MATRIX_WIDTH (NUM_COLS * MATRIX_PANELS)
+#define NUM_LEDS (MATRIX_WIDTH * MATRIX_HEIGHT)
+
+// Refresh rate and blanking are runtime settings, see scanSetRefresh(). Rows advance on every
+// TCB0 interrupt; ghosting is hidden by holding OE off for a short window around each latch
+// inside the same interrupt, rather than by shifting out extra blank rows.
+#ifndef SCAN_REFRESH_HZ
+#define SCAN_REFRESH_HZ 250 // full frames per second at boot
+#endif
+#ifndef SCAN_BLANK_US
+#define SCAN_BLANK_US (NUM_ROWS <= 8 ? 5 : 0) // OE-off window per latch at boot
+#endif
+#define SCAN_BLANK_MAX_US 20 // the window is busy-waited in the ISR, so it stays short
+#define SCAN_BLANK_SHARE 8   // and at most 1/8 of the shortest slot
+
+#define SCAN_TIMER_HZ (F_CPU / 2)
+#define SCAN_TICKS_PER_US (SCAN_TIMER_HZ / 1000000UL)
+#define SCAN_PERIOD (SCAN_TIMER_HZ / (SCAN_REFRESH_HZ * (uint32_t)NUM_ROWS) - 1) // boot TCB0 compare value
+#define SCAN_SPI_HZ 4000000UL // SPI.begin() default clock
+#define SCAN_ISR_TICKS 100    // headroom for the ISR around the burst when clamping the period
+
+// A chain of identical panels, each a column data register followed by an active-low row select
+// register of one row word each. Everything below is a compile-time constant, so a row burst is
+// an unrolled run of SPI writes with the panel offsets folded in. The farthest panel goes first,
+// so panel 0 (columns 0..Cols - 1) is the one next to the controller.
+template <uint8_t Cols, uint8_t Rows, uint8_t Panels>
+struct ScanMatrix
+{
+    typedef typename GridWord<(Cols <= 8), (Cols <= 16)>::type row_t;
+
+    static_assert(Cols == 8 || Cols == 16, "panels are 8 or 16 columns wide");
+    static_assert(Rows <= Cols, "row select shares the column word size");
+    static_assert(Panels >= 1 && Rows * Panels <= 255, "1 to 255 / Rows panels");
+
+    static constexpr row_t Blank = (row_t)~(row_t)0;
+    static constexpr uint8_t Slots = Rows;               // row slots per frame and plane
+    static constexpr uint8_t PlaneWords = Rows * Panels; // one bitplane, panel after panel
+    static constexpr uint8_t RowBytes = Panels * 2 * sizeof(row_t);
+
+    // timer ticks the SPI needs for one burst
+    static constexpr uint32_t BurstTicks = RowBytes * 8UL * SCAN_TIMER_HZ / SCAN_SPI_HZ;
+
+    template <uint8_t Panel> struct PanelIndex {};
+
+    template <typename Sink>
+    static inline void shiftPanels(Sink &, const row_t *, row_t, PanelIndex<0>) {}
+
+    template <typename Sink, uint8_t Panel>
+    static inline void shiftPanels(Sink &sink, const row_t *rows, row_t select, PanelIndex<Panel>)
+    {
+        sink.put(rows ? (row_t)~rows[(Panel - 1) * Rows] : Blank);
+        sink.put(select);
+        shiftPanels(sink, rows, select, PanelIndex<Panel - 1>());
+    }
 
-// draw variables
-rowdata_t drawBuffer[NUM_ROWS];             // draw updates go here
-volatile rowdata_t displayBuffer[NUM_ROWS]; // ISR shifts out data from this, copies new data from drawBuffer
+    // one row of every panel from `rows` (the word of panel 0, later panels Rows words apart),
+    // all dark when rows is null
+    template <typename Sink>
+    static inline void shiftRow(Sink &sink, const row_t *rows, row_t select)
+    {
+        shiftPanels(sink, rows, select, PanelIndex<Panels>());
+    }
+};
+
+typedef ScanMatrix<NUM_COLS, NUM_ROWS, MATRIX_PANELS> Matrix;
+typedef Matrix::row_t rowdata_t;
+
+// blocking SPI writes, a whole word per call
+struct SpiSink
+{
+    inline void put(uint8_t data) { SPI.transfer(data); }
+    inline void put(uint16_t data) { SPI.transfer16(data); }
+};
+
+// bytes for the SPI interrupt, MSB first like SPI.transfer16()
+struct ByteSink
+{
+    uint8_t *next;
+
+    inline void put(uint8_t data) { *next++ = data; }
+    inline void put(uint16_t data)
+    {
+        *next++ = data >> 8;
+        *next++ = data;
+    }
+};
+
+// -DSCAN_BCM enables binary code modulation: each frame holds NUM_PLANES bitplanes and plane p
+// of a row stays latched for 2^p base periods, so levels double per plane but ISR rate only
+// grows with the number of planes. A row's slot keeps the same total length as in 1-bit mode.
+#if defined(SCAN_BCM)
+#ifndef SCAN_BCM_PLANES
+#define SCAN_BCM_PLANES 2
+#endif
+#define NUM_PLANES SCAN_BCM_PLANES
+#else
+#define NUM_PLANES 1
+#endif
+#define MAX_INTENSITY ((1 << NUM_PLANES) - 1)
+
+// the blocking burst runs inside the ISR, and the async one must finish before the next slot;
+// runtime rates are clamped the same way by scanSetRefresh()
+static_assert(Matrix::BurstTicks + SCAN_BLANK_US * SCAN_TICKS_PER_US < (SCAN_PERIOD + 1) / MAX_INTENSITY,
+              "row burst outlasts the shortest scan slot, use fewer panels or planes or a lower SCAN_REFRESH_HZ");
+static_assert(SCAN_BLANK_US <= SCAN_BLANK_MAX_US, "SCAN_BLANK_US is longer than SCAN_BLANK_MAX_US");
+
+// frame pool: three buffers rotate between renderer (draw), pending (ready) and ISR (display),
+// so publishing never blocks the renderer and never touches the frame being scanned out
+// each buffer is NUM_PLANES consecutive bitplanes, least significant plane first, and each plane
+// holds NUM_ROWS words per panel, panel 0 first
+rowdata_t frameBuffers[3][NUM_PLANES * Matrix::PlaneWords];
+rowdata_t *drawBuffer = frameBuffers[0];           // draw updates go here
+rowdata_t *volatile readyBuffer = frameBuffers[1]; // last published frame, or free when !bufferUpdate
+rowdata_t *displayBuffer = frameBuffers[2];        // ISR shifts out data from this, only touched by ISR
+
+// the ATtiny817 has 512 B of SRAM, and after the maze, the scheduler, the core libraries and the
+// stack reserve the pool gets the 96 B of one 16x16 panel; chained walls and 16x16 BCM need a part
+// with more SRAM, raise -DSCAN_FRAME_BUDGET for it
+#if defined(__AVR__) && !defined(SCAN_FRAME_BUDGET)
+#define SCAN_FRAME_BUDGET 96
+#endif
+#if defined(SCAN_FRAME_BUDGET)
+static_assert(sizeof(frameBuffers) <= SCAN_FRAME_BUDGET,
+              "frame pool is over SCAN_FRAME_BUDGET, use fewer panels or planes or a part with more SRAM");
+#endif
 
 // ISR state variables
-volatile bool bufferUpdate = false; // flag to signal ISR that buffer needs to change/be updated
+volatile bool bufferUpdate = false; // flag to signal ISR that readyBuffer holds a new frame
 volatile uint8_t curLine = 0;
-volatile uint8_t blankCycles = 0; // off cycles between each line write
 bool displayEnabled;
+uint16_t scanPeriod = SCAN_PERIOD;                        // TCB0 compare value per row slot
+uint16_t scanBcmBase = (SCAN_PERIOD + 1) / MAX_INTENSITY; // BCM: ticks of the least significant plane
+uint8_t scanBlankUs = SCAN_BLANK_US;                      // OE-off window per latch, 0 for none
+uint8_t drawIntensity = MAX_INTENSITY; // level used by scanOrRow() and scanSetPixel()
+
+#if defined(SCAN_BCM)
+volatile uint8_t curPlane = 0;
+#endif
+
+// frame and ISR load counters, read back over I2C by telemetry.h; they wrap at 16 bits
+#define SCAN_LOAD_SLOTS 32                           // slots per scanIsrTicksAvg
+#define SCAN_LOAD_MAX_TICKS (0xFFFF / SCAN_LOAD_SLOTS) // longer ISRs count as this in the mean
+volatile uint16_t scanFramesPublished = 0; // scanPublish() calls
+volatile uint16_t scanFramesDropped = 0;   // published frames replaced before the ISR showed them
+volatile uint16_t scanFramesShown = 0;     // frame flips in the ISR
+volatile uint16_t scanIsrTicksAvg = 0;     // TCB0 ticks (CLK_PER / 2) from row slot start to ISR exit
+volatile uint16_t scanIsrTicksMax = 0;
+uint16_t scanIsrTicksSum = 0;
+uint8_t scanIsrSamples = 0;
+
+#if defined(SCAN_SPI_ASYNC)
+uint8_t spiTxBytes[Matrix::RowBytes]; // row data then row select per panel, farthest first
+volatile uint8_t spiTxIndex = Matrix::RowBytes;
+#endif
 
 void scanClear()
 {
-    for (int i = 0; i < NUM_ROWS; i++)
+    for (int i = 0; i < NUM_PLANES * Matrix::PlaneWords; i++)
     {
         drawBuffer[i] = 0;
     }
 }
 
+void scanSetIntensity(uint8_t intensity)
+{
+    drawIntensity = intensity > MAX_INTENSITY ? MAX_INTENSITY : intensity;
+}
+
+// light the masked pixels of a row at the current intensity; pixels already lit keep their
+// level, so drawing near-to-far lets nearer (brighter) geometry win at shared pixels
+inline void scanOrRow(uint8_t row, rowdata_t mask)
+{
+#if defined(SCAN_BCM)
+    rowdata_t lit = 0;
+    for (uint8_t plane = 0; plane < NUM_PLANES; plane++)
+        lit |= drawBuffer[plane * Matrix::PlaneWords + row];
+    mask &= ~lit;
+    for (uint8_t plane = 0; plane < NUM_PLANES; plane++)
+    {
+        if (drawIntensity & (1 << plane))
+            drawBuffer[plane * Matrix::PlaneWords + row] |= mask;
+    }
+#else
+    drawBuffer[row] |= mask;
+#endif
+}
+
+// Output orientation for panels mounted turned or mirrored, applied once per published frame in
+// scanPublish() so everything upstream keeps drawing upright. The frame is square, so each of the
+// eight orientations is an optional transpose followed by optional X/Y flips, all done a row word
+// at a time: the transpose swaps ever smaller blocks between row pairs with masked shifts
+// (log2(N) passes over the frame) and the X flip reverses the bits within each word likewise.
+// Requests are quarter turns (x = bit, y = row) in bits 1..0 plus mirrors applied before turning.
+#define ORIENT_MIRROR_H 0x04
+#define ORIENT_MIRROR_V 0x08
+#ifndef SCAN_ORIENTATION
+#define SCAN_ORIENTATION 0 // request applied at boot, e.g. -DSCAN_ORIENTATION=2 for 180 degrees
+#endif
+
+#define SCAN_SWAP_XY 0x01
+#define SCAN_FLIP_X 0x02
+#define SCAN_FLIP_Y 0x04
+
+static_assert(NUM_ROWS == NUM_COLS, "orientation needs square panels");
+
+volatile uint8_t scanOrientation = 0; // SCAN_SWAP_XY, then SCAN_FLIP_X / SCAN_FLIP_Y
+
+// (x, y) -> (y, x) by swapping j-sized blocks between rows k and k + j, masks select the low blocks
+inline void scanTransposeStage(rowdata_t *rows, uint8_t j, rowdata_t mask)
+{
+    for (uint8_t k = 0; k < NUM_ROWS; k = (k + j + 1) & ~j)
+    {
+        rowdata_t t = ((rows[k] >> j) ^ rows[k + j]) & mask;
+        rows[k] ^= t << j;
+        rows[k + j] ^= t;
+    }
+}
+
+inline rowdata_t scanReverseRow(rowdata_t x)
+{
+    x = (x >> 1 & (rowdata_t)0x5555) | (rowdata_t)((x & (rowdata_t)0x5555) << 1);
+    x = (x >> 2 & (rowdata_t)0x3333) | (rowdata_t)((x & (rowdata_t)0x3333) << 2);
+    x = (x >> 4 & (rowdata_t)0x0F0F) | (rowdata_t)((x & (rowdata_t)0x0F0F) << 4);
+#if NUM_COLS > 8
+    x = x >> 8 | x << 8;
+#endif
+    return x;
+}
+
+// every panel is turned in place, chained walls keep their panel order
+void scanOrientFrame(rowdata_t *frame, uint8_t orientation)
+{
+    for (uint8_t block = 0; block < NUM_PLANES * MATRIX_PANELS; block++)
+    {
+        rowdata_t *rows = frame + block * NUM_ROWS;
+        if (orientation & SCAN_SWAP_XY)
+        {
+#if NUM_ROWS > 8
+            scanTransposeStage(rows, 8, 0x00FF);
+#endif
+            scanTransposeStage(rows, 4, (rowdata_t)0x0F0F);
+            scanTransposeStage(rows, 2, (rowdata_t)0x3333);
+            scanTransposeStage(rows, 1, (rowdata_t)0x5555);
+        }
+        if (orientation & SCAN_FLIP_X)
+        {
+            for (uint8_t row = 0; row < NUM_ROWS; row++)
+                rows[row] = scanReverseRow(rows[row]);
+        }
+        if (orientation & SCAN_FLIP_Y)
+        {
+            for (uint8_t row = 0; row < NUM_ROWS / 2; row++)
+            {
+                rowdata_t t = rows[row];
+                rows[row] = rows[NUM_ROWS - 1 - row];
+                rows[NUM_ROWS - 1 - row] = t;
+            }
+        }
+    }
+}
+
+// quarter turns and ORIENT_MIRROR_* to transpose/flip form; mirrors move across the transpose
+void scanSetOrientation(uint8_t request)
+{
+    static const uint8_t turns[4] = {0, SCAN_SWAP_XY | SCAN_FLIP_X, SCAN_FLIP_X | SCAN_FLIP_Y, SCAN_SWAP_XY | SCAN_FLIP_Y};
+    uint8_t orientation = turns[request & 3];
+    bool swapped = orientation & SCAN_SWAP_XY;
+    if (request & ORIENT_MIRROR_H)
+        orientation ^= swapped ? SCAN_FLIP_Y : SCAN_FLIP_X;
+    if (request & ORIENT_MIRROR_V)
+        orientation ^= swapped ? SCAN_FLIP_X : SCAN_FLIP_Y;
+    scanOrientation = orientation;
+}
+
+// the orientation that undoes `orientation`, for frames read back after publishing
+inline uint8_t scanInverseOrientation(uint8_t orientation)
+{
+    uint8_t flips = orientation & (SCAN_FLIP_X | SCAN_FLIP_Y);
+    if ((orientation & SCAN_SWAP_XY) && (flips == SCAN_FLIP_X || flips == SCAN_FLIP_Y))
+        return orientation ^ (SCAN_FLIP_X | SCAN_FLIP_Y); // a single flip swaps axes across the transpose
+    return orientation;
+}
+
 void scanDisplay(bool enabled)
 {
     displayEnabled = enabled;
-    digitalWrite(OE_PIN, !displayEnabled);
+    if (displayEnabled)
+        SCAN_VPORT.OUT &= ~OE_bm;
+    else
+        SCAN_VPORT.OUT |= OE_bm;
+}
+
+// Full frames per second and the OE-off window around each latch. The slot is clamped so it
+// always holds the row burst and the ISR itself (for BCM, in the shortest plane) and still fits
+// the 16-bit timer; the ISR picks the new period up at the next slot. The window never stretches
+// the slot: it is capped at SCAN_BLANK_MAX_US and 1/SCAN_BLANK_SHARE of the shortest slot, since
+// it is busy-waited inside the ISR.
+void scanSetRefresh(uint16_t hz, uint8_t blankUs)
+{
+    uint32_t minPeriod = (Matrix::BurstTicks + SCAN_ISR_TICKS) * MAX_INTENSITY;
+    uint32_t period = hz ? SCAN_TIMER_HZ / ((uint32_t)hz * NUM_ROWS) : 0xFFFF;
+    if (period < minPeriod)
+        period = minPeriod;
+    if (period > 0xFFFF)
+        period = 0xFFFF;
+
+    uint16_t maxBlankUs = period / MAX_INTENSITY / SCAN_BLANK_SHARE / SCAN_TICKS_PER_US;
+    if (maxBlankUs > SCAN_BLANK_MAX_US)
+        maxBlankUs = SCAN_BLANK_MAX_US;
+    if (blankUs > maxBlankUs)
+        blankUs = maxBlankUs;
+
+    uint8_t oldSREG = SREG;
+    cli();
+    scanPeriod = period - 1;
+    scanBcmBase = period / MAX_INTENSITY;
+    scanBlankUs = blankUs;
+    SREG = oldSREG;
 }
 
 void scanInit()
@@ -63,96 +368,221 @@ void scanInit()
     digitalWrite(LATCH_PIN, LOW);
 
     SPI.begin();
+#if defined(SCAN_SPI_ASYNC)
+    SPI0.CTRLB |= SPI_BUFEN_bm | SPI_SSD_bm; // buffered mode, no SS pin
+    SPI0.INTCTRL = 0;
+#endif
 
-    // Configure Timer B (TCA0) for CTC mode at 8kHz from 10MHz
+    // Configure Timer B (TCA0) for CTC mode at SCAN_REFRESH_HZ * NUM_ROWS from 10MHz
     TCB0.CTRLA = TCB_ENABLE_bm | TCB_CLKSEL_CLKDIV2_gc;
     TCB0.CTRLB = TCB_CNTMODE_INT_gc; // CTC mode
-    TCB0.CCMP = 1249 * 2;            // (20Mhz / 2) / 1250 = 8kHz
+    TCB0.CCMP = SCAN_PERIOD;         // (20Mhz / 2) / 2500 = 4kHz at 250 Hz on 16 rows
     TCB0.INTCTRL = TCB_CAPT_bm;      // Enable interrupt on capture
+
+    scanSetOrientation(SCAN_ORIENTATION);
+    scanSetRefresh(SCAN_REFRESH_HZ, SCAN_BLANK_US);
 }
 
+uint16_t scanRefreshHz()
+{
+    return SCAN_TIMER_HZ / ((scanPeriod + 1UL) * NUM_ROWS);
+}
+
+// share of the CPU taken by TCB0_INT_vect over the last SCAN_LOAD_SLOTS slots, in 1/1000; with
+// SCAN_SPI_ASYNC the per-byte SPI0_INT_vect comes on top. Each row slot runs the ISR once per plane.
+uint16_t scanIsrLoad()
+{
+    uint8_t oldSREG = SREG;
+    cli();
+    uint16_t isr = scanIsrTicksAvg;
+    uint32_t rowTicks = (uint32_t)scanBcmBase * MAX_INTENSITY;
+    SREG = oldSREG;
+    return (uint32_t)isr * NUM_PLANES * 1000 / rowTicks;
+}
+
+// x spans the whole chain
 void scanSetPixel(int x, int y, bool on)
 {
-    if (x < 0 || x >= NUM_COLS || y < 0 || y >= NUM_ROWS)
+    if (x < 0 || x >= MATRIX_WIDTH || y < 0 || y >= NUM_ROWS)
         return;
 
+    uint8_t word = x / NUM_COLS * NUM_ROWS + y;
+    rowdata_t mask = (rowdata_t)1 << (x % NUM_COLS);
     if (on)
-        drawBuffer[y] |= (1 << x);
+    {
+        scanOrRow(word, mask);
+    }
     else
-        drawBuffer[y] &= ~(1 << x);
+    {
+        for (uint8_t plane = 0; plane < NUM_PLANES; plane++)
+            drawBuffer[plane * Matrix::PlaneWords + word] &= ~mask;
+    }
 }
 
+// row words continue panel after panel, 0..Matrix::PlaneWords - 1
 void scanSetRow(uint8_t row, rowdata_t rowData)
 {
-    drawBuffer[row] = rowData;
+    for (uint8_t plane = 0; plane < NUM_PLANES; plane++)
+        drawBuffer[plane * Matrix::PlaneWords + row] = (drawIntensity & (1 << plane)) ? rowData : 0;
 }
 
-void scanShow()
+// back buffer the renderer may freely write until the next scanPublish()
+rowdata_t *scanAcquire()
+{
+    return drawBuffer;
+}
+
+// hand the back buffer to the ISR and take the spare one, dropping any frame still pending
+void scanPublish()
 {
+    if (scanOrientation)
+        scanOrientFrame(drawBuffer, scanOrientation);
+
+    uint8_t oldSREG = SREG;
+    cli();
+    rowdata_t *published = drawBuffer;
+    drawBuffer = readyBuffer;
+    readyBuffer = published;
+    if (bufferUpdate)
+        scanFramesDropped++;
     bufferUpdate = true;
+    scanFramesPublished++;
+    SREG = oldSREG;
+}
+
+void scanShow()
+{
+    scanPublish();
 }
 
 void scanTest()
 {
     for (int i = 0; i < NUM_ROWS; i++)
     {
-        for (int j = 0; j < NUM_COLS; j++)
+        for (int j = 0; j < MATRIX_WIDTH; j++)
         {
             scanSetPixel(j, i, true);
         }
     }
     scanShow();
+}
 
-    delay(2000);
-
-    scanClear();
-    scanShow();
+// move the shifted row to the outputs; with a blank window the panels stay dark across the
+// switch so the old row's drivers settle before the new row lights up
+inline void scanLatch()
+{
+    if (displayEnabled && scanBlankUs)
+    {
+        SCAN_VPORT.OUT |= OE_bm;
+        SCAN_VPORT.OUT &= ~LATCH_bm;
+        SCAN_VPORT.OUT |= LATCH_bm;
+        delayMicroseconds(scanBlankUs);
+        SCAN_VPORT.OUT &= ~OE_bm;
+        return;
+    }
+    SCAN_VPORT.OUT &= ~LATCH_bm;
+    SCAN_VPORT.OUT |= LATCH_bm;
 }
 
-ISR(TCB0_INT_vect)
+// one row slot of the scan, the body of TCB0_INT_vect
+inline void scanStep()
 {
     // clear interrupt flag
     TCB0.INTFLAGS = TCB_CAPT_bm;
 
-    // calculate row data and select
-    rowdata_t rowData = BLANK_DATA;
-    rowdata_t rowSelect = BLANK_DATA;
-    if (displayEnabled && blankCycles == 0)
+    // calculate row data and select, null rows blank every panel
+    const rowdata_t *rows = nullptr;
+    rowdata_t rowSelect = Matrix::Blank;
+    if (displayEnabled)
     {
-        rowData = ~displayBuffer[curLine];
+#if defined(SCAN_BCM)
+        rows = displayBuffer + curPlane * Matrix::PlaneWords + curLine;
+#else
+        rows = displayBuffer + curLine;
+#endif
         rowSelect = ~(0x01 << curLine);
     }
 
 // shift out row data
-#if defined(MATRIX_16X16)
-    SPI.transfer16(rowData);
-    SPI.transfer16(rowSelect);
-#elif defined(MATRIX_8X8)
-    SPI.transfer(rowData);
-    SPI.transfer(rowSelect);
+#if defined(SCAN_SPI_ASYNC)
+    if (spiTxIndex < Matrix::RowBytes || SPI0.INTCTRL)
+        return; // previous row still streaming, keep the line where it is
+    ByteSink sink = {spiTxBytes};
+    Matrix::shiftRow(sink, rows, rowSelect);
+    SPI0.INTFLAGS = SPI_TXCIF_bm;
+    SPI0.DATA = spiTxBytes[0];
+    spiTxIndex = 1;
+    SPI0.INTCTRL = SPI_DREIE_bm; // SPI0_INT_vect feeds the rest and latches
+#else
+    SpiSink sink;
+    Matrix::shiftRow(sink, rows, rowSelect);
+    scanLatch();
 #endif
-    digitalWrite(LATCH_PIN, LOW);
-    digitalWrite(LATCH_PIN, HIGH);
 
-    // update the current line and blank cycles
-    if (blankCycles == 0)
+#if defined(SCAN_BCM)
+    // weight the on-time of the plane just latched
+    TCB0.CCMP = (scanBcmBase << curPlane) - 1;
+
+    // stay on this line until all of its planes have been shown
+    if (++curPlane < NUM_PLANES)
+        return;
+    curPlane = 0;
+#else
+    TCB0.CCMP = scanPeriod;
+#endif
+
+    curLine = (curLine + 1) % NUM_ROWS;
+
+    // flip to new frame if available after finishing last frame
+    if (bufferUpdate && curLine == 0)
     {
-        curLine = (curLine + 1) % NUM_ROWS;
-        blankCycles = NUM_BLANK_CYCLES;
+        rowdata_t *shown = displayBuffer;
+        displayBuffer = readyBuffer;
+        readyBuffer = shown;
+        bufferUpdate = false;
+        scanFramesShown++;
     }
-    else
+}
+
+ISR(TCB0_INT_vect)
+{
+    PROFILE_SCOPE(PROFILE_SCAN_ISR);
+    scanStep();
+
+    // the counter restarted at the compare match, so it now holds latency plus run time
+    uint16_t ticks = TCB0.CNT;
+    if (ticks > scanIsrTicksMax)
+        scanIsrTicksMax = ticks;
+    scanIsrTicksSum += ticks < SCAN_LOAD_MAX_TICKS ? ticks : SCAN_LOAD_MAX_TICKS;
+    if (++scanIsrSamples == SCAN_LOAD_SLOTS)
     {
-        blankCycles--;
+        scanIsrTicksAvg = scanIsrTicksSum / SCAN_LOAD_SLOTS;
+        scanIsrTicksSum = 0;
+        scanIsrSamples = 0;
     }
+}
+
+#if defined(SCAN_SPI_ASYNC)
+ISR(SPI0_INT_vect)
+{
+    PROFILE_SCOPE(PROFILE_SPI_ISR);
 
-    // swap in new frame if available after finishing last frame
-    if (bufferUpdate && curLine == 0 && blankCycles == NUM_BLANK_CYCLES)
+    // data register empty: queue the next byte, then wait for the shift register to drain
+    if (spiTxIndex < Matrix::RowBytes)
     {
-        for (int i = 0; i < NUM_ROWS; i++)
+        SPI0.DATA = spiTxBytes[spiTxIndex++];
+        if (spiTxIndex == Matrix::RowBytes)
         {
-            displayBuffer[i] = drawBuffer[i];
+            // drop the completion of an earlier byte so only the last one can raise TXCIF
+            SPI0.INTFLAGS = SPI_TXCIF_bm;
+            SPI0.INTCTRL = SPI_TXCIE_bm;
         }
-
-        bufferUpdate = false;
+        return;
     }
-}
\ No newline at end of file
+
+    // transfer complete: all bits are in the shift registers, latch them out
+    SPI0.INTFLAGS = SPI_TXCIF_bm;
+    SPI0.INTCTRL = 0;
+    scanLatch();
+}
+#endif
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <Arduino.h>
+#include <avr/sleep.h>
+
+// Cooperative scheduler for a fixed task table. Each task returns how many ms until it wants
+// to run again, or TASK_IDLE to wait until taskWake(). Between deadlines the CPU sits in IDLE
+// sleep; any interrupt (scan timer, millis, I2C) wakes it to re-check the table.
+#define TASK_IDLE 0xFFFF
+
+typedef uint16_t (*task_fn_t)();
+
+// the functions go in a const table that stays in flash, only deadlines take RAM
+struct Task
+{
+  unsigned long due; // millis() timestamp, compared wraparound-safe
+};
+
+volatile uint8_t taskWakeMask = 0;
+uint8_t taskWaitMask = 0; // TASK_IDLE returned, only taskWake() makes it due
+
+// safe from ISRs and the main loop
+void taskWake(uint8_t task)
+{
+  uint8_t oldSREG = SREG;
+  cli();
+  taskWakeMask |= bit(task);
+  SREG = oldSREG;
+}
+
+// wraparound-safe delay until a millis() deadline, 0 if it already passed
+inline uint16_t msUntil(unsigned long deadline)
+{
+  long remaining = (long)(deadline - millis());
+  return remaining <= 0 ? 0 : (remaining >= TASK_IDLE ? TASK_IDLE - 1 : remaining);
+}
+
+inline bool taskDue(const Task *tasks, uint8_t task, unsigned long now)
+{
+  return !(taskWaitMask & bit(task)) && (long)(now - tasks[task].due) >= 0;
+}
+
+void schedulerRun(const task_fn_t *run, Task *tasks, uint8_t count)
+{
+  uint8_t oldSREG = SREG;
+  cli();
+  uint8_t wake = taskWakeMask;
+  taskWakeMask = 0;
+  SREG = oldSREG;
+
+  unsigned long now = millis();
+  for (uint8_t i = 0; i < count; i++)
+  {
+    if (wake & bit(i))
+    {
+      taskWaitMask &= ~bit(i);
+      tasks[i].due = now;
+    }
+    if (!taskDue(tasks, i, now))
+      continue;
+
+    uint16_t wait = run[i]();
+    now = millis();
+    if (wait == TASK_IDLE)
+      taskWaitMask |= bit(i);
+    else
+      taskWaitMask &= ~bit(i);
+    tasks[i].due = now + wait;
+  }
+
+  // a deadline already passed: run again instead of waiting for the next interrupt
+  now = millis();
+  for (uint8_t i = 0; i < count; i++)
+  {
+    if (taskDue(tasks, i, now))
+      return;
+  }
+
+  // sleep unless a wake arrived while tasks ran; sei() before sleep_cpu() keeps the check race-free
+  set_sleep_mode(SLEEP_MODE_IDLE);
+  cli();
+  if (!taskWakeMask)
+  {
+    sleep_enable();
+    sei();
+    sleep_cpu();
+    sleep_disable();
+  }
+  sei();
+}
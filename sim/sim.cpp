@@ -0,0 +1,293 @@
+// Headless simulator: runs the sketch's setup()/loop() against the native stand-ins and a virtual
+// clock, and captures every frame the scan ISR flips to. Built by env:native_sim:
+//   pio run -e native_sim && .pio/build/native_sim/program [options]
+//
+//   --seed S       seed the first maze with S and each next one with the seed after it (default
+//                  1), 0 seeds every maze from the virtual clock
+//   --frames N     stop after N captured frames (default 200)
+//   --mazes N      stop after N completed mazes instead (not with MAZE_ENDLESS)
+//   --ascii        print each frame, '.' off, '#' full, digits for BCM levels
+//   --pbm DIR      write each frame as DIR/frame_NNNNN.pbm
+//   --record FILE  write the frame sequence as a golden file
+//   --check FILE   compare against a golden file, exit 1 at the first difference
+//
+// Soak run, mazes/s, frames per maze and the slowest loop pass that produced a frame:
+//   program --mazes 5000
+//
+// Golden check, the first 400 frames of seed 1 (one maze and into the next), env:native_sim flags:
+//   .pio/build/native_sim/program --frames 400 --check sim/golden/seed1_16x16.txt
+// After an intended change to the picture or its timing, re-record it with --record instead.
+//
+// Virtual time jumps straight to the next task deadline, so a run costs only what the tasks do.
+// Golden files hold the frame text with its virtual timestamp, so they also catch timing changes;
+// they only match a build with the flags they were recorded with.
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "main.cpp"
+
+#define SIM_STALL_MS 60000UL // no frame for this long means the sketch is stuck
+
+struct SimOptions
+{
+  uint32_t seed = 1;
+  uint32_t frames = 200;
+  uint32_t mazes = 0;
+  bool ascii = false;
+  const char *pbmDir = nullptr;
+  const char *recordPath = nullptr;
+  const char *checkPath = nullptr;
+};
+
+SimOptions options;
+FILE *recordFile = nullptr;
+FILE *checkFile = nullptr;
+uint32_t simFrames = 0;
+uint32_t simMazes = 0;        // telemetryMazesCompleted is 16 bits and wraps on long soaks
+uint16_t simMazesCounted = 0; // telemetryMazesCompleted already added to simMazes
+uint32_t checkLine = 0;
+double worstFrameNs = 0;
+
+// level of pixel (x, y) in the shown frame, 0..MAX_INTENSITY
+uint8_t simPixel(const rowdata_t *frame, uint8_t x, uint8_t y)
+{
+  uint8_t word = x / NUM_COLS * NUM_ROWS + y;
+  uint8_t bit = x % NUM_COLS;
+  uint8_t level = 0;
+  for (uint8_t plane = 0; plane < NUM_PLANES; plane++)
+    level |= ((frame[plane * Matrix::PlaneWords + word] >> bit) & 1) << plane;
+  return level;
+}
+
+// one text line of the frame, or the frame header for row -1
+void simFrameLine(const rowdata_t *frame, int8_t row, char *line)
+{
+  if (row < 0)
+  {
+    sprintf(line, "frame %u t=%lu", simFrames, millis());
+    return;
+  }
+  for (uint8_t x = 0; x < MATRIX_WIDTH; x++)
+  {
+    uint8_t level = simPixel(frame, x, row);
+    line[x] = level == 0 ? '.' : level == MAX_INTENSITY ? '#' : '0' + level;
+  }
+  line[MATRIX_WIDTH] = 0;
+}
+
+void simCheckLine(const char *line)
+{
+  char expected[MATRIX_WIDTH + 32];
+  checkLine++;
+  if (!fgets(expected, sizeof(expected), checkFile))
+  {
+    printf("golden ends before line %u: %s\n", checkLine, line);
+    exit(1);
+  }
+  expected[strcspn(expected, "\n")] = 0;
+  if (strcmp(expected, line))
+  {
+    printf("mismatch at line %u (frame %u)\n  expected %s\n  got      %s\n", checkLine, simFrames, expected, line);
+    exit(1);
+  }
+}
+
+void simWritePbm(const rowdata_t *frame)
+{
+  char path[256];
+  snprintf(path, sizeof(path), "%s/frame_%05u.pbm", options.pbmDir, simFrames);
+  FILE *file = fopen(path, "w");
+  if (!file)
+  {
+    printf("cannot write %s\n", path);
+    exit(1);
+  }
+  fprintf(file, "P1\n%d %d\n", MATRIX_WIDTH, MATRIX_HEIGHT);
+  for (uint8_t y = 0; y < MATRIX_HEIGHT; y++)
+  {
+    for (uint8_t x = 0; x < MATRIX_WIDTH; x++)
+      fputs(simPixel(frame, x, y) ? "1 " : "0 ", file);
+    fputs("\n", file);
+  }
+  fclose(file);
+}
+
+void simCapture(const rowdata_t *frame)
+{
+  char line[MATRIX_WIDTH + 32];
+  for (int8_t row = -1; row < MATRIX_HEIGHT; row++)
+  {
+    simFrameLine(frame, row, line);
+    if (options.ascii)
+      puts(line);
+    if (recordFile)
+      fprintf(recordFile, "%s\n", line);
+    if (checkFile)
+      simCheckLine(line);
+  }
+  if (options.pbmDir)
+    simWritePbm(frame);
+  simFrames++;
+}
+
+// scan the published frame in the way the ISR would until it is the one on display
+void simShow()
+{
+  uint16_t shown = scanFramesShown;
+  while (scanFramesShown == shown)
+  {
+    TCB0_INT_vect();
+#if defined(SCAN_SPI_ASYNC)
+    while (SPI0.INTCTRL)
+      SPI0_INT_vect();
+#endif
+  }
+}
+
+// once a maze has taken the override, line up the next seed so every maze of a run differs
+void simNextSeed()
+{
+  if (rngSeedOverride && mazeSeed == rngSeedOverride)
+    rngSeedOverride = mazeSeed + 1 ? mazeSeed + 1 : 1;
+}
+
+// next millis() at which a task is due, now if one already is
+unsigned long simNextDue()
+{
+  unsigned long now = millis();
+  if (taskWakeMask)
+    return now;
+
+  long next = SIM_STALL_MS;
+  for (uint8_t i = 0; i < NUM_TASKS; i++)
+  {
+    if (taskWaitMask & bit(i))
+      continue;
+    long wait = (long)(tasks[i].due - now);
+    if (wait <= 0)
+      return now;
+    if (wait < next)
+      next = wait;
+  }
+  return now + next;
+}
+
+bool simDone()
+{
+  simMazes += (uint16_t)(telemetryMazesCompleted - simMazesCounted);
+  simMazesCounted = telemetryMazesCompleted;
+  if (options.mazes)
+    return simMazes >= options.mazes;
+  return simFrames >= options.frames;
+}
+
+void simParse(int argc, char **argv)
+{
+  for (int i = 1; i < argc; i++)
+  {
+    const char *arg = argv[i];
+    const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+    if (!strcmp(arg, "--ascii"))
+    {
+      options.ascii = true;
+      continue;
+    }
+    if (!value)
+    {
+      printf("unknown option or missing value: %s\n", arg);
+      exit(2);
+    }
+    i++;
+    if (!strcmp(arg, "--seed"))
+      options.seed = strtoul(value, nullptr, 0);
+    else if (!strcmp(arg, "--frames"))
+      options.frames = strtoul(value, nullptr, 0);
+    else if (!strcmp(arg, "--mazes"))
+      options.mazes = strtoul(value, nullptr, 0);
+    else if (!strcmp(arg, "--pbm"))
+      options.pbmDir = value;
+    else if (!strcmp(arg, "--record"))
+      options.recordPath = value;
+    else if (!strcmp(arg, "--check"))
+      options.checkPath = value;
+    else
+    {
+      printf("unknown option: %s\n", arg);
+      exit(2);
+    }
+  }
+#if defined(MAZE_ENDLESS)
+  if (options.mazes)
+  {
+    printf("--mazes: an endless maze never completes, use --frames\n");
+    exit(2);
+  }
+#endif
+}
+
+int main(int argc, char **argv)
+{
+  simParse(argc, argv);
+  if (options.recordPath && !(recordFile = fopen(options.recordPath, "w")))
+  {
+    printf("cannot write %s\n", options.recordPath);
+    return 2;
+  }
+  if (options.checkPath && !(checkFile = fopen(options.checkPath, "r")))
+  {
+    printf("cannot read %s\n", options.checkPath);
+    return 2;
+  }
+
+  rngSeedOverride = options.seed;
+  setup();
+  simNextSeed();
+
+  auto start = std::chrono::steady_clock::now();
+  unsigned long lastFrame = 0;
+  while (!simDone())
+  {
+    auto passStart = std::chrono::steady_clock::now();
+    loop();
+    simNextSeed();
+    if (bufferUpdate)
+    {
+      double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - passStart).count();
+      if (ns > worstFrameNs)
+        worstFrameNs = ns;
+      simShow();
+      simCapture(displayBuffer);
+      lastFrame = millis();
+    }
+
+    nativeMillis = simNextDue();
+    if (millis() - lastFrame > SIM_STALL_MS)
+    {
+      printf("stalled: no frame since t=%lu\n", lastFrame);
+      return 1;
+    }
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  if (recordFile)
+    fclose(recordFile);
+  if (checkFile)
+  {
+    char extra[MATRIX_WIDTH + 32];
+    if (fgets(extra, sizeof(extra), checkFile))
+    {
+      printf("golden has more frames than the run, line %u: %s", checkLine + 1, extra);
+      return 1;
+    }
+    printf("golden match, %u frames\n", simFrames);
+  }
+
+  uint32_t mazes = simMazes;
+  printf("%u frames, %u mazes, %.1f virtual s in %.3f s: %.1f mazes/s, %.1f frames/maze, worst frame %.1f us\n",
+         simFrames, mazes, millis() / 1000.0, seconds, mazes / seconds, mazes ? (double)simFrames / mazes : 0.0,
+         worstFrameNs / 1000.0);
+  return 0;
+}
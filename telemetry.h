@@ -0,0 +1,130 @@
+#pragma once
+
+#include <Arduino.h>
+#include <Wire.h>
+
+#include "rng.h"
+#include "scan.h"
+
+// Read-back register map for monitoring panels from the I2C master. Write the read command with a
+// register offset, then read up to TELEMETRY_SIZE - offset bytes; a bare read starts at 0.
+// One read returns at most 32 bytes (the Wire buffer), registers past 0x1F need an offset.
+// Multi-byte registers are little endian. Counters run from boot and wrap at 16 bits.
+#define TELEMETRY_VERSION 4
+
+struct __attribute__((packed)) TelemetryRegisters
+{
+  uint8_t version;            // 0x00  TELEMETRY_VERSION
+  uint16_t framesRendered;    // 0x01  frames published by the renderer or host
+  uint16_t framesDropped;     // 0x03  published frames replaced before they were shown
+  uint16_t framesShown;       // 0x05  frames the scan ISR flipped to
+  uint16_t isrCyclesAvg;      // 0x07  TCB0_INT_vect, slot start to exit, mean of the last 32
+  uint16_t isrCyclesMax;      // 0x09
+  uint16_t drawMazeUs;        // 0x0B  last drawMaze() that drew a frame
+  uint16_t drawMazeUsMax;     // 0x0D
+  uint16_t generateMazeUs;    // 0x0F  generator time summed over the ticks of the last maze
+  uint16_t generateMazeUsMax; // 0x11
+  uint16_t mazesCompleted;    // 0x13
+  uint16_t stepsLastMaze;     // 0x15  cells walked from start to exit
+  uint16_t freeSram;          // 0x17  between heap and stack at the time of the read
+  uint32_t mazeSeed;          // 0x19  seed that regenerates the current maze (endless: the stream)
+  uint16_t isrLoad;           // 0x1D  CPU share of TCB0_INT_vect in 1/1000, see scanIsrLoad()
+  uint16_t refreshHz;         // 0x1F  full frames per second
+  uint8_t blankUs;            // 0x21  OE-off window per latch
+};
+
+#define TELEMETRY_SIZE sizeof(TelemetryRegisters)
+
+// updated by the main loop tasks
+uint16_t telemetryDrawMazeUs = 0;
+uint16_t telemetryDrawMazeUsMax = 0;
+uint16_t telemetryGenerateMazeUs = 0;
+uint16_t telemetryGenerateMazeUsMax = 0;
+uint16_t telemetryGenerateAccumUs = 0; // maze currently being carved, saturates
+uint16_t telemetryMazesCompleted = 0;
+uint16_t telemetryStepsThisMaze = 0;
+uint16_t telemetryStepsLastMaze = 0;
+
+uint8_t telemetryOffset = 0; // first register of the next read
+
+inline uint16_t telemetrySaturate(unsigned long us)
+{
+  return us > 0xFFFF ? 0xFFFF : us;
+}
+
+void telemetryDrawMaze(unsigned long us)
+{
+  telemetryDrawMazeUs = telemetrySaturate(us);
+  if (telemetryDrawMazeUs > telemetryDrawMazeUsMax)
+    telemetryDrawMazeUsMax = telemetryDrawMazeUs;
+}
+
+// one generator tick, `done` once the maze is complete
+void telemetryGenerateMaze(unsigned long us, bool done)
+{
+  telemetryGenerateAccumUs = telemetrySaturate(telemetryGenerateAccumUs + us);
+  if (!done)
+    return;
+  telemetryGenerateMazeUs = telemetryGenerateAccumUs;
+  if (telemetryGenerateMazeUs > telemetryGenerateMazeUsMax)
+    telemetryGenerateMazeUsMax = telemetryGenerateMazeUs;
+  telemetryGenerateAccumUs = 0;
+}
+
+void telemetryStep()
+{
+  telemetryStepsThisMaze++;
+}
+
+void telemetryMazeCompleted()
+{
+  telemetryMazesCompleted++;
+  telemetryStepsLastMaze = telemetryStepsThisMaze;
+  telemetryStepsThisMaze = 0;
+}
+
+#if defined(__AVR__)
+extern char __heap_start;
+extern char *__brkval;
+#endif
+
+uint16_t freeSram()
+{
+#if defined(__AVR__)
+  char top;
+  return &top - (__brkval ? __brkval : &__heap_start);
+#else
+  return 0; // no meaningful figure on the host
+#endif
+}
+
+void telemetrySelect(uint8_t offset)
+{
+  telemetryOffset = offset < TELEMETRY_SIZE ? offset : 0;
+}
+
+// Wire.onRequest handler, runs in the TWI interrupt so the scan ISR can't change counters mid-copy
+void telemetryRequest()
+{
+  TelemetryRegisters regs;
+  regs.version = TELEMETRY_VERSION;
+  regs.framesRendered = scanFramesPublished;
+  regs.framesDropped = scanFramesDropped;
+  regs.framesShown = scanFramesShown;
+  regs.isrCyclesAvg = scanIsrTicksAvg * 2; // TCB0 runs at CLK_PER / 2
+  regs.isrCyclesMax = scanIsrTicksMax * 2;
+  regs.drawMazeUs = telemetryDrawMazeUs;
+  regs.drawMazeUsMax = telemetryDrawMazeUsMax;
+  regs.generateMazeUs = telemetryGenerateMazeUs;
+  regs.generateMazeUsMax = telemetryGenerateMazeUsMax;
+  regs.mazesCompleted = telemetryMazesCompleted;
+  regs.stepsLastMaze = telemetryStepsLastMaze;
+  regs.freeSram = freeSram();
+  regs.mazeSeed = mazeSeed;
+  regs.isrLoad = scanIsrLoad();
+  regs.refreshHz = scanRefreshHz();
+  regs.blankUs = scanBlankUs;
+
+  Wire.write((const uint8_t *)&regs + telemetryOffset, TELEMETRY_SIZE - telemetryOffset);
+  telemetryOffset = 0;
+}
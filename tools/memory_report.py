@@ -0,0 +1,51 @@
+# PlatformIO post-build script for env:memory: prints a per-symbol RAM/flash breakdown of the
+# firmware and fails the build when static RAM leaves less than custom_stack_reserve bytes of
+# the custom_sram_budget for the call stack and interrupts.
+#   pio run -e memory
+Import("env")
+
+import subprocess
+
+TOP_SYMBOLS = 25
+
+
+def symbols(elf):
+    nm = env.subst("$CC").replace("gcc", "nm")
+    output = subprocess.check_output([nm, "--size-sort", "-S", "-C", elf], universal_newlines=True)
+    ram, flash = [], []
+    for line in output.splitlines():
+        parts = line.split(None, 3)
+        if len(parts) < 4:
+            continue
+        size, kind, name = int(parts[1], 16), parts[2].lower(), parts[3]
+        if kind in "bd":
+            ram.append((size, name))
+        if kind in "dtrw":
+            flash.append((size, name))  # initialized data also stores its initializer in flash
+    return ram, flash
+
+
+def table(title, entries, total):
+    print("%s: %d bytes" % (title, total))
+    for size, name in sorted(entries, reverse=True)[:TOP_SYMBOLS]:
+        print("  %6d  %s" % (size, name))
+
+
+def report(source, target, env):
+    budget = int(env.GetProjectOption("custom_sram_budget", "512"))
+    reserve = int(env.GetProjectOption("custom_stack_reserve", "96"))
+
+    ram, flash = symbols(str(target[0]))
+    ram_total = sum(size for size, _ in ram)
+    table("static RAM", ram, ram_total)
+    table("flash", flash, sum(size for size, _ in flash))
+
+    limit = budget - reserve
+    print("static RAM %d of %d bytes allowed (%d SRAM, %d stack reserve)" % (ram_total, limit, budget, reserve))
+    if ram_total > limit:
+        print("error: static RAM over budget by %d bytes" % (ram_total - limit))
+        return 1
+    return 0
+
+
+env.AddPostAction("$BUILD_DIR/${PROGNAME}.elf", report)